@@ -4,41 +4,554 @@
 // duplicate or collinear points.
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <random>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 
+// SIMD kernels are picked at runtime from what the CPU supports.
+// Define CONVEXHULL_NO_SIMD to build with the scalar kernels only.
+#if !defined(CONVEXHULL_NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CONVEXHULL_X86_SIMD 1
+#include <immintrin.h>
+#elif !defined(CONVEXHULL_NO_SIMD) && defined(__ARM_NEON)
+#define CONVEXHULL_NEON_SIMD 1
+#include <arm_neon.h>
+#endif
+
+// Where there's POSIX, point files are read through mmap and output
+// can go straight to a file descriptor.
+#if defined(__unix__) || defined(__APPLE__)
+#define CONVEXHULL_POSIX 1
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// On Linux, HullService can pin its workers to cores.
+#ifdef __linux__
+#define CONVEXHULL_AFFINITY 1
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 using namespace std;
 
-struct point {
-	float x;
-	float y;
+// What the algorithms did on the calling thread, counted when built
+// with CONVEXHULL_STATS. A build without it counts nothing and costs
+// nothing, and these all stay zero. Threads the algorithms start count
+// towards their own stats, not their caller's.
+struct HullStats {
+	// Cross products found, either by ccw or by the side-scan kernels.
+	uint64_t ccwCount;
+	// Points dropped by quickHull's partitions and by aklToussaint.
+	uint64_t partitionDiscards;
+	uint64_t prefilterDiscards;
+	// Points popped off the stack by the monotone chain and Graham scan.
+	uint64_t pops;
+	// quickHull's current depth of recursion, and the deepest so far.
+	uint64_t depth;
+	uint64_t maxDepth;
+	// Bytes allocated by operator new.
+	uint64_t bytesAllocated;
+	// Time spent sorting points, scanning them for the hull, and
+	// merging partial hulls. A merge that finds a hull of its own counts
+	// that sort and scan too.
+	double sortSeconds;
+	double scanSeconds;
+	double mergeSeconds;
+};
+
+// The calling thread's stats.
+HullStats& hullStats() {
+	static thread_local HullStats stats = HullStats();
+	return stats;
+}
+
+void resetHullStats() {
+	hullStats() = HullStats();
+}
+
+#define HULL_CONCAT2(a, b) a##b
+#define HULL_CONCAT(a, b) HULL_CONCAT2(a, b)
+
+#ifdef CONVEXHULL_STATS
+// Adds seconds since construction to a timer of hullStats().
+struct PhaseTimer {
+	double& seconds;
+	chrono::steady_clock::time_point start;
+
+	explicit PhaseTimer(double& inSeconds) : seconds(inSeconds), start(chrono::steady_clock::now()) { }
+
+	~PhaseTimer() {
+		seconds += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+};
+
+// Counts one more level of quickHull recursion while it's in scope.
+struct DepthScope {
+	DepthScope() {
+		HullStats& stats = hullStats();
+		stats.maxDepth = max(stats.maxDepth, ++stats.depth);
+	}
+
+	~DepthScope() {
+		--hullStats().depth;
+	}
+};
+
+#define HULL_COUNT(field, n) (hullStats().field += (n))
+#define HULL_DEPTH() DepthScope HULL_CONCAT(depthScope, __LINE__)
+#define HULL_TIME(phase) PhaseTimer HULL_CONCAT(phaseTimer, __LINE__)(hullStats().phase##Seconds)
+#else
+#define HULL_COUNT(field, n) ((void)0)
+#define HULL_DEPTH() ((void)0)
+#define HULL_TIME(phase) ((void)0)
+#endif
+
+// Trace scopes. With CONVEXHULL_TRACY they're Tracy zones. With
+// CONVEXHULL_TRACE they're recorded for writeTrace(), which writes the
+// Chrome trace event JSON that Perfetto's UI opens. Otherwise they're
+// nothing.
+#if defined(CONVEXHULL_TRACY)
+#include <tracy/Tracy.hpp>
+#define HULL_TRACE(name) ZoneScopedN(name)
+#elif defined(CONVEXHULL_TRACE)
+// One complete event: a named scope on a thread.
+struct TraceEvent {
+	const char* name;
+	size_t thread;
+	double begin;
+	double end;
+};
+
+// The events recorded so far, from every thread.
+struct TraceLog {
+	mutex lock;
+	vector<TraceEvent> events;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	atomic<size_t> threads{0};
+};
+
+TraceLog& traceLog() {
+	static TraceLog log;
+	return log;
+}
+
+// Records the time it's in scope as an event.
+struct TraceScope {
+	const char* name;
+	double begin;
+
+	static double now() {
+		return chrono::duration<double, micro>(chrono::steady_clock::now() - traceLog().start).count();
+	}
+
+	static size_t threadId() {
+		static thread_local size_t id = traceLog().threads++;
+		return id;
+	}
+
+	explicit TraceScope(const char* inName) : name(inName), begin(now()) { }
+
+	~TraceScope() {
+		const TraceEvent event = { name, threadId(), begin, now() };
+		TraceLog& log = traceLog();
+		lock_guard<mutex> guard(log.lock);
+		log.events.push_back(event);
+	}
+};
+
+// Writes the events recorded so far to path, as JSON.
+void writeTrace(const string& path) {
+	TraceLog& log = traceLog();
+	lock_guard<mutex> guard(log.lock);
+	ofstream out(path);
+	out << "{\"traceEvents\":[";
+	for (size_t i = 0; i < log.events.size(); ++i) {
+		const TraceEvent& e = log.events[i];
+		out << (i ? ",\n" : "\n") << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":"
+			<< e.thread << ",\"ts\":" << e.begin << ",\"dur\":" << e.end - e.begin << "}";
+	}
+	out << "\n]}\n";
+}
+
+#define HULL_TRACE(name) TraceScope HULL_CONCAT(traceScope, __LINE__)(name)
+#else
+#define HULL_TRACE(name) ((void)0)
+#endif
+
+// Times a phase into hullStats(), and traces it.
+#define HULL_PHASE(phase) HULL_TIME(phase); HULL_TRACE(#phase)
+
+// A point with coordinates of type T. Most of what follows is for
+// float points, the four main algorithms are for any T.
+template <typename T>
+struct basic_point {
+	T x;
+	T y;
+
+	basic_point() : x(0), y(0) { }
+
+	basic_point(T xIn, T yIn) : x(xIn), y(yIn) { } 
+};
+
+typedef basic_point<float> point;
+typedef basic_point<double> dpoint;
+typedef basic_point<int16_t> spoint;
+typedef basic_point<int32_t> ipoint;
+typedef basic_point<int64_t> lpoint;
+
+// Allocates arrays aligned to a cache line, so vector loads
+// of point coordinates never straddle two lines.
+template <typename T, size_t Alignment = 64>
+struct AlignedAllocator {
+	typedef T value_type;
+
+	template <typename U>
+	struct rebind {
+		typedef AlignedAllocator<U, Alignment> other;
+	};
+
+	AlignedAllocator() { }
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) { }
+
+	T* allocate(size_t n) {
+		return static_cast<T*>(::operator new(n * sizeof(T), align_val_t(Alignment)));
+	}
+
+	void deallocate(T* p, size_t) {
+		::operator delete(p, align_val_t(Alignment));
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+// Points stored as separate x and y arrays (structure of arrays).
+// Loops over one coordinate at a time vectorize cleanly, and columnar
+// point data can be copied in without interleaving it first.
+struct PointSoA {
+	vector<float, AlignedAllocator<float>> x;
+	vector<float, AlignedAllocator<float>> y;
+
+	PointSoA() { }
+
+	explicit PointSoA(size_t n) : x(n), y(n) { }
+
+	PointSoA(const float* xIn, const float* yIn, size_t n)
+		: x(xIn, xIn + n), y(yIn, yIn + n) { }
+
+	explicit PointSoA(const vector<point>& v) {
+		x.reserve(v.size());
+		y.reserve(v.size());
+		for (auto p : v) {
+			push_back(p);
+		}
+	}
+
+	size_t size() const { return x.size(); }
 
-	point(float xIn, float yIn) : x(xIn), y(yIn) { } 
+	bool empty() const { return x.empty(); }
+
+	point operator[](size_t i) const { return point(x[i], y[i]); }
+
+	void clear() {
+		x.clear();
+		y.clear();
+	}
+
+	void push_back(const point& p) {
+		x.push_back(p.x);
+		y.push_back(p.y);
+	}
+
+	void swap(size_t i, size_t j) {
+		std::swap(x[i], x[j]);
+		std::swap(y[i], y[j]);
+	}
+};
+
+// Copies the points v[lo, hi) into a vector.
+vector<point> toPoints(const vector<point>& v, size_t lo, size_t hi) {
+	return vector<point>(v.begin() + lo, v.begin() + hi);
+}
+
+// Interleaves the points v[lo, hi) into a vector.
+vector<point> toPoints(const PointSoA& v, size_t lo, size_t hi) {
+	vector<point> w;
+	w.reserve(hi - lo);
+	for (size_t i = lo; i < hi; ++i) {
+		w.push_back(v[i]);
+	}
+	return w;
+}
+
+vector<point> toPoints(const PointSoA& v) {
+	return toPoints(v, 0, v.size());
+}
+
+// Buffers that the hull algorithms reuse from one call to the next.
+// Once they have grown to fit the largest input, passing the same
+// workspace to each call means the calls stop allocating. A workspace
+// is for one thread at a time.
+template <typename T>
+struct BasicHullWorkspace {
+	// The working copy of the input points.
+	vector<basic_point<T>> points;
+	// The hull, and the two monotone chains it's built from.
+	vector<basic_point<T>> hull;
+	vector<basic_point<T>> lower;
+	vector<basic_point<T>> upper;
+	// The rest are only used for float points, except that integer
+	// points sort through the keys too.
+	// Keys and digit counts for radixSort().
+	vector<uint64_t> keys;
+	vector<uint64_t> sortedKeys;
+	vector<size_t> counts;
+	// The working copy and scratch space of the PointSoA quickHull,
+	// and the candidates prunedGiftWrapping wraps.
+	PointSoA soaPoints;
+	PointSoA soaScratch;
+	// The sorted vertices of the hulls mergeHulls merges.
+	vector<point> merged;
+	// The order GrahamScan's presort puts points in, and scratch.
+	vector<size_t> order;
+	vector<size_t> sortedOrder;
+};
+
+typedef BasicHullWorkspace<float> HullWorkspace;
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef __int128 int128;
+#else
+// A 128-bit two's complement integer, for compilers without __int128,
+// with just the arithmetic cross products of int32 and int64
+// coordinates need.
+struct TwoWordInt {
+	uint64_t hi;
+	uint64_t lo;
+
+	TwoWordInt(int64_t v = 0) : hi(v < 0 ? ~uint64_t(0) : 0), lo(uint64_t(v)) { }
+	TwoWordInt(uint64_t inHi, uint64_t inLo) : hi(inHi), lo(inLo) { }
+
+	friend TwoWordInt operator+(const TwoWordInt& a, const TwoWordInt& b) {
+		const uint64_t lo = a.lo + b.lo;
+		return TwoWordInt(a.hi + b.hi + (lo < a.lo), lo);
+	}
+
+	friend TwoWordInt operator-(const TwoWordInt& a, const TwoWordInt& b) {
+		return TwoWordInt(a.hi - b.hi - (a.lo < b.lo), a.lo - b.lo);
+	}
+
+	TwoWordInt operator-() const {
+		return TwoWordInt() - *this;
+	}
+
+	// The low 128 bits of the product, which are the product in two's
+	// complement whenever it fits.
+	friend TwoWordInt operator*(const TwoWordInt& a, const TwoWordInt& b) {
+		const uint64_t mask = 0xFFFFFFFFu;
+		const uint64_t a0 = a.lo & mask, a1 = a.lo >> 32;
+		const uint64_t b0 = b.lo & mask, b1 = b.lo >> 32;
+		const uint64_t low = a0 * b0;
+		const uint64_t middle = (low >> 32) + (a1 * b0 & mask) + a0 * b1;
+		const uint64_t high = a1 * b1 + (a1 * b0 >> 32) + (middle >> 32);
+		return TwoWordInt(high + a.hi * b.lo + a.lo * b.hi, (middle << 32) | (low & mask));
+	}
+
+	friend bool operator==(const TwoWordInt& a, const TwoWordInt& b) {
+		return a.hi == b.hi && a.lo == b.lo;
+	}
+
+	friend bool operator!=(const TwoWordInt& a, const TwoWordInt& b) {
+		return !(a == b);
+	}
+
+	friend bool operator<(const TwoWordInt& a, const TwoWordInt& b) {
+		return a.hi != b.hi ? int64_t(a.hi) < int64_t(b.hi) : a.lo < b.lo;
+	}
+
+	friend bool operator>(const TwoWordInt& a, const TwoWordInt& b) {
+		return b < a;
+	}
+
+	friend bool operator<=(const TwoWordInt& a, const TwoWordInt& b) {
+		return !(b < a);
+	}
+
+	friend bool operator>=(const TwoWordInt& a, const TwoWordInt& b) {
+		return !(a < b);
+	}
+};
+
+typedef TwoWordInt int128;
+#endif
+
+// The type cross products of T coordinates are found in. For the
+// integer types it's wide enough to be exact, for int64 coordinates
+// as long as they're within 2^62 of zero.
+template <typename T>
+struct Wide {
+	typedef T type;
+};
+
+template <>
+struct Wide<int16_t> {
+	typedef int64_t type;
+};
+
+template <>
+struct Wide<int32_t> {
+	typedef int128 type;
+};
+
+template <>
+struct Wide<int64_t> {
+	typedef int128 type;
 };
 
 // The z-value of the cross product of segments 
 // (a, b) and (a, c). Positive means c is ccw
 // from (a, b), negative cw. Zero means its collinear.
-float ccw(const point& a, const point& b, const point& c) {
-	return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+template <typename T>
+typename Wide<T>::type ccw(const basic_point<T>& a, const basic_point<T>& b, const basic_point<T>& c) {
+	typedef typename Wide<T>::type W;
+	HULL_COUNT(ccwCount, 1);
+	return (W(b.x) - a.x) * (W(c.y) - a.y) - (W(b.y) - a.y) * (W(c.x) - a.x);
+}
+
+// The relative rounding error of a double.
+const double doubleRoundoff = 1.0 / (uint64_t(1) << 53);
+
+// Shewchuk's bound on the error of a cross product found in double,
+// relative to the sum of the magnitudes of its two products.
+// https://www.cs.cmu.edu/~quake/robust.html
+const double ccwErrorBound = (3 + 16 * doubleRoundoff) * doubleRoundoff;
+
+// Returns ccw(a, b, c) with its sign always right, even for nearly
+// collinear points, where the float one can have the wrong sign. The
+// cross product is found in double, and only if it's too close to
+// zero for its sign to be sure is it found again exactly. The exact
+// sum is of the six products in its expansion, each exact in double
+// since floats have under half a double's bits, added into a
+// nonoverlapping expansion with twoSum. The largest part of that has
+// the sign of the whole.
+double exactCcw(const point& a, const point& b, const point& c) {
+	HULL_COUNT(ccwCount, 1);
+	const double left = (double(b.x) - a.x) * (double(c.y) - a.y);
+	const double right = (double(b.y) - a.y) * (double(c.x) - a.x);
+	const double det = left - right;
+	if (fabs(det) > ccwErrorBound * (fabs(left) + fabs(right))) {
+		return det;
+	}
+
+	const double products[6] = {
+		double(a.x) * b.y, -double(a.x) * c.y, double(b.x) * c.y,
+		-double(b.x) * a.y, double(c.x) * a.y, -double(c.x) * b.y,
+	};
+	// parts[0, n) is the expansion so far, smallest first.
+	double parts[6];
+	size_t n = 0;
+	for (double q : products) {
+		for (size_t i = 0; i < n; ++i) {
+			// twoSum: sum + error is exactly q + parts[i].
+			const double sum = q + parts[i];
+			const double bVirtual = sum - q;
+			const double aVirtual = sum - bVirtual;
+			parts[i] = (q - aVirtual) + (parts[i] - bVirtual);
+			q = sum;
+		}
+		parts[n++] = q;
+	}
+	for (size_t i = n; i-- > 0; ) {
+		if (parts[i] != 0) {
+			return parts[i];
+		}
+	}
+	return 0;
 }
 
+// The orientation test the templated algorithms use unless they're
+// given another: ccw in the arithmetic of the point's type.
+struct Ccw {
+	template <typename T>
+	typename Wide<T>::type operator()(const basic_point<T>& a, const basic_point<T>& b,
+		const basic_point<T>& c) const {
+		return ccw(a, b, c);
+	}
+};
+
+// The filtered exact test, for float points.
+struct ExactCcw {
+	double operator()(const point& a, const point& b, const point& c) const {
+		return exactCcw(a, b, c);
+	}
+};
+
+// Orders points lexicographically, for sets of points.
+struct isLeftOfSorter {
+	template <typename T>
+	bool operator()(const basic_point<T>& a, const basic_point<T>& b) const {
+		return (a.x < b.x || (a.x == b.x && a.y < b.y));
+	}
+};
+
 // Returns true if a is lexicographically before b.
 bool isLeftOf(const point& a, const point& b) {
-	return (a.x < b.x || (a.x == b.x && a.y < b.y));
+	return isLeftOfSorter()(a, b);
 }
 
 // Used to sort points in ccw order about a pivot.
+template <typename T, typename Orientation = Ccw>
 struct ccwSorter {
-	const point& pivot;
+	const basic_point<T>& pivot;
+	Orientation orient;
 
-	ccwSorter(const point& inPivot) : pivot(inPivot) { }
+	ccwSorter(const basic_point<T>& inPivot, Orientation inOrient = Orientation())
+		: pivot(inPivot), orient(inOrient) { }
 
-	bool operator()(const point& a, const point& b) {
-		return ccw(pivot, a, b) < 0;
+	bool operator()(const basic_point<T>& a, const basic_point<T>& b) {
+		return orient(pivot, a, b) < 0;
 	}
 };
 
+// The magnitude of a cross product of any type.
+template <typename W>
+W magnitude(W w) {
+	return w < 0 ? -w : w;
+}
+
 // The length of segment (a, b).
 float len(const point& a, const point& b) {
 	return sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
@@ -49,13 +562,18 @@ float dist(const point& a, const point& b, const point& p) {
 	return fabs((b.x - a.x) * (a.y - p.y) - (b.y - a.y) * (a.x - p.x)) / len(a, b);
 }
 
-// Returns the index of the farthest point from segment (a, b).
-size_t getFarthest(const point& a, const point& b, const vector<point>& v) {
-	size_t idxMax = 0;
-	float distMax = dist(a, b, v[idxMax]);
+// Returns the index of the farthest point from segment (a, b)
+// among v[lo, hi). The magnitude of the cross product is the
+// distance scaled by len(a, b), which is the same for every point,
+// so we compare that and skip the sqrt and divide in dist().
+template <typename T, typename Orientation = Ccw>
+size_t getFarthest(const basic_point<T>& a, const basic_point<T>& b, const vector<basic_point<T>>& v,
+				   size_t lo, size_t hi, Orientation orient = Orientation()) {
+	size_t idxMax = lo;
+	auto distMax = magnitude(orient(a, b, v[idxMax]));
 
-	for (size_t i = 1; i < v.size(); ++i) {
-		float distCurr = dist(a, b, v[i]);
+	for (size_t i = lo + 1; i < hi; ++i) {
+		auto distCurr = magnitude(orient(a, b, v[i]));
 		if (distCurr > distMax) {
 			idxMax = i;
 			distMax = distCurr;
@@ -65,196 +583,5532 @@ size_t getFarthest(const point& a, const point& b, const vector<point>& v) {
 	return idxMax;
 }
 
+// Returns the index of the farthest point from segment (a, b).
+size_t getFarthest(const point& a, const point& b, const vector<point>& v) {
+	return getFarthest(a, b, v, 0, v.size());
+}
 
 // The gift-wrapping algorithm for convex hull.
 // https://en.wikipedia.org/wiki/Gift_wrapping_algorithm
-vector<point> giftWrapping(vector<point> v) {
+// Finds the hull of v[0, n) using the buffers in ws, and returns
+// ws.hull.
+// Points are compared with orient, ccw by default.
+template <typename T, typename Orientation = Ccw>
+const vector<basic_point<T>>& giftWrapping(const basic_point<T>* in, size_t n, BasicHullWorkspace<T>& ws,
+	Orientation orient = Orientation()) {
+	HULL_TRACE("giftWrapping");
+	vector<basic_point<T>>& v = ws.points;
+	v.assign(in, in + n);
+	vector<basic_point<T>>& hull = ws.hull;
+	hull.clear();
+	if (n < 2) {
+		hull.assign(v.begin(), v.end());
+		return hull;
+	}
+
 	// Move the leftmost point to the beginning of our vector.
 	// It will be the first point in our convext hull.
-	swap(v[0], *min_element(v.begin(), v.end(), isLeftOf));
+	swap(v[0], *min_element(v.begin(), v.end(), isLeftOfSorter()));
 
-	vector<point> hull;
+	// Points collinear with our last hull point are passed over for
+	// the farthest of them.
+	typedef typename Wide<T>::type W;
+	auto before = [&](const basic_point<T>& a, const basic_point<T>& b) {
+		const auto turn = orient(v[0], a, b);
+		return turn < 0 || (turn == 0 &&
+			magnitude(W(a.x) - v[0].x) + magnitude(W(a.y) - v[0].y) >
+			magnitude(W(b.x) - v[0].x) + magnitude(W(b.y) - v[0].y));
+	};
 	// Repeatedly find the first ccw point from our last hull point
 	// and put it at the front of our array. 
-	// Stop when we see our first point again.
+	// Stop when we see our first point again, or after n points in
+	// case rounding keeps us from getting back to it.
+	HULL_PHASE(scan);
 	do {
 		hull.push_back(v[0]);
-		swap(v[0], *min_element(v.begin() + 1, v.end(), ccwSorter(v[0])));
-	} while (v[0].x != hull[0].x && v[0].y != hull[0].y);
+		swap(v[0], *min_element(v.begin() + 1, v.end(), before));
+	} while ((v[0].x != hull[0].x || v[0].y != hull[0].y) && hull.size() < n);
 
 	return hull;
 }
 
+// As above, copying the hull to out, which needs room for n points.
+// Returns the number of hull points.
+size_t giftWrapping(const point* v, size_t n, point* out, HullWorkspace& ws) {
+	const vector<point>& hull = giftWrapping(v, n, ws);
+	copy(hull.begin(), hull.end(), out);
+	return hull.size();
+}
 
-// The Graham scan algorithm for convex hull.
-// https://en.wikipedia.org/wiki/Graham_scan
-vector<point> GrahamScan(vector<point> v) {
-	// Put our leftmost point at index 0
-	swap(v[0], *min_element(v.begin(), v.end(), isLeftOf));
+template <typename T, typename Orientation = Ccw>
+vector<basic_point<T>> giftWrapping(const vector<basic_point<T>>& v, Orientation orient = Orientation()) {
+	BasicHullWorkspace<T> ws;
+	giftWrapping(v.data(), v.size(), ws, orient);
+	return move(ws.hull);
+}
 
-	// Sort the rest of the points in counter-clockwise order
-	// from our leftmost point.
-	sort(v.begin() + 1, v.end(), ccwSorter(v[0]));
-	
-	// Add our first three points to the hull.
-	vector<point> hull;
-	auto it = v.begin();
-	hull.push_back(*it++);
-	hull.push_back(*it++);
-	hull.push_back(*it++);
-	
-	while (it != v.end()) {
-		// Pop off any points that make a convex angle with *it
-		while (ccw(*(hull.rbegin() + 1), *(hull.rbegin()), *it) >= 0) {
-			hull.pop_back();
-		}
-		hull.push_back(*it++);
-	}
+vector<point> giftWrapping(const vector<point>& v) {
+	return giftWrapping(v, Ccw());
+}
 
-	return hull;
+vector<point> giftWrapping(const PointSoA& v) {
+	return giftWrapping(toPoints(v));
 }
 
 
-// The monotone chain algorithm for convex hull.
-vector<point> monotoneChain(vector<point> v) {
-	// Sort our points in lexicographic order.
-	sort(v.begin(), v.end(), isLeftOf);
-	
-	// Find the lower half of the convex hull.
-	vector<point> lower;
-	for (auto it = v.begin(); it != v.end(); ++it) {
-		// Pop off any points that make a convex angle with *it
-		while (lower.size() >= 2 && ccw(*(lower.rbegin() + 1), *(lower.rbegin()), *it) >= 0) {
-			lower.pop_back();
+// Calls f(i) for each i in [0, count) on up to threadCount threads,
+// which take indices one at a time.
+template <typename Function>
+void parallelFor(size_t count, unsigned threadCount, Function f) {
+	atomic<size_t> next(0);
+	auto work = [&] {
+		for (size_t i; (i = next.fetch_add(1)) < count; ) {
+			f(i);
 		}
-		lower.push_back(*it);
+	};
+	const size_t threads = min<size_t>(max(threadCount, 1u), count);
+	vector<thread> pool;
+	for (size_t t = 1; t < threads; ++t) {
+		pool.emplace_back(work);
 	}
-		
-	// Find the upper half of the convex hull.
-	vector<point> upper;
-	for (auto it = v.rbegin(); it != v.rend(); ++it) {
-		// Pop off any points that make a convex angle with *it
-		while (upper.size() >= 2 && ccw(*(upper.rbegin() + 1), *(upper.rbegin()), *it) >= 0) {
-			upper.pop_back();
-		}
-		upper.push_back(*it);
+	work();
+	for (auto& t : pool) {
+		t.join();
 	}
-
-	vector<point> hull;
-	hull.insert(hull.end(), lower.begin(), lower.end());
-	// Both hulls include both endpoints, so leave them out when we 
-	// append the upper hull.
-	hull.insert(hull.end(), upper.begin() + 1, upper.end() - 1);
-	return hull;
 }
 
+// The smallest chunk of points worth handing to its own thread.
+// Below this, starting the thread costs more than it saves.
+const size_t minPointsPerThread = 1 << 14;
 
-// Recursive call of the quickhull algorithm.
-void quickHull(const vector<point>& v, const point& a, const point& b, 
-			   vector<point>& hull) {
-	if (v.empty()) {
-		return;
+// Sorts keys[i] and values[i] by key with a stable LSD radix sort over
+// 11-bit digits. Digits that are the same in every key are skipped.
+// Each pass counts the digits of up to threadCount blocks of keys in
+// parallel, then each block scatters its keys in parallel, starting
+// past those of the blocks before it.
+void radixSortPairs(vector<uint64_t>& keys, vector<size_t>& values,
+	vector<uint64_t>& sortedKeys, vector<size_t>& sortedValues, vector<size_t>& counts,
+	unsigned threadCount) {
+	const size_t digitBits = 11;
+	const size_t buckets = size_t(1) << digitBits;
+	const size_t n = keys.size();
+	sortedKeys.resize(n);
+	sortedValues.resize(n);
+
+	uint64_t every = ~uint64_t(0);
+	uint64_t some = 0;
+	for (uint64_t key : keys) {
+		every &= key;
+		some |= key;
+	}
+	const uint64_t varying = every ^ some;
+
+	const size_t blocks = max<size_t>(min<size_t>(max(threadCount, 1u), n / minPointsPerThread), 1);
+	const size_t blockSize = (n + blocks - 1) / blocks;
+	for (size_t shift = 0; shift < 64; shift += digitBits) {
+		if (((varying >> shift) & (buckets - 1)) == 0) {
+			continue;
+		}
+		counts.assign(blocks * buckets, 0);
+		parallelFor(blocks, threadCount, [&](size_t b) {
+			size_t* count = &counts[b * buckets];
+			for (size_t i = b * blockSize; i < min(n, (b + 1) * blockSize); ++i) {
+				++count[(keys[i] >> shift) & (buckets - 1)];
+			}
+		});
+		size_t offset = 0;
+		for (size_t d = 0; d < buckets; ++d) {
+			for (size_t b = 0; b < blocks; ++b) {
+				const size_t c = counts[b * buckets + d];
+				counts[b * buckets + d] = offset;
+				offset += c;
+			}
+		}
+		parallelFor(blocks, threadCount, [&](size_t b) {
+			size_t* count = &counts[b * buckets];
+			for (size_t i = b * blockSize; i < min(n, (b + 1) * blockSize); ++i) {
+				const size_t j = count[(keys[i] >> shift) & (buckets - 1)]++;
+				sortedKeys[j] = keys[i];
+				sortedValues[j] = values[i];
+			}
+		});
+		keys.swap(sortedKeys);
+		values.swap(sortedValues);
 	}
+}
 
-	point f = v[getFarthest(a, b, v)];
+// The point count above which angularSort() sorts with
+// radixSortPairs(). Below it, sort() on the keys is faster.
+const size_t angularRadixThreshold = 1 << 12;
 
-	// Collect points to the left of segment (a, f)
-	vector<point> left;
-	for (auto p : v) {
-		if (ccw(a, f, p) > 0) {
-			left.push_back(p);
+// A key that sorts points in cw order about pivot, for points on or
+// right of it, found once per point. A point at (dx, dy) from the
+// pivot, with dx >= 0, has a pseudo-angle dy / (dx + |dy|), which goes
+// from 1 straight up to -1 straight down in step with the angle. For
+// points with coordinates of four bytes or fewer, dx and dy are exact
+// in double, so collinear points get the same key and the rounded
+// division never puts two points in the wrong order. Repeats of the
+// pivot come first.
+template <typename T>
+uint64_t angleKey(const basic_point<T>& pivot, const basic_point<T>& p) {
+	const double dx = double(p.x) - double(pivot.x);
+	const double dy = double(p.y) - double(pivot.y);
+	if (dx == 0 && dy == 0) {
+		return 0;
+	}
+	// Adding zero turns -0 into 0, so both get the same key.
+	const double t = -dy / (dx + fabs(dy)) + 0.0;
+	uint64_t u;
+	memcpy(&u, &t, sizeof(u));
+	return u ^ ((u >> 63) ? ~uint64_t(0) : uint64_t(1) << 63);
+}
+
+// Sorts v[1, n) in cw order about the pivot v[0], by orient and then
+// nearer to break ties. Each point's angleKey is found once, and the
+// keys sort with their indices, by radixSortPairs on threadCount
+// threads for large inputs. Points with the same key are then sorted
+// by orient, which also orders collinear points, and runs all on one
+// ray by nearer alone.
+template <typename T, typename Orientation, typename Nearer>
+void angularSort(vector<basic_point<T>>& v, BasicHullWorkspace<T>& ws, Orientation orient,
+	Nearer nearer, unsigned threadCount) {
+	const basic_point<T> pivot = v[0];
+	auto before = [&](const basic_point<T>& a, const basic_point<T>& b) {
+		const auto turn = orient(pivot, a, b);
+		return turn < 0 || (turn == 0 && nearer(a, b));
+	};
+	const size_t m = v.size() - 1;
+	vector<uint64_t>& keys = ws.keys;
+	vector<size_t>& order = ws.order;
+	keys.resize(m);
+	order.resize(m);
+	for (size_t i = 0; i < m; ++i) {
+		keys[i] = angleKey(v[0], v[i + 1]);
+		order[i] = i + 1;
+	}
+	if (m >= angularRadixThreshold) {
+		radixSortPairs(keys, order, ws.sortedKeys, ws.sortedOrder, ws.counts, threadCount);
+	} else {
+		sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a - 1] < keys[b - 1]; });
+		ws.sortedKeys.resize(m);
+		for (size_t i = 0; i < m; ++i) {
+			ws.sortedKeys[i] = keys[order[i] - 1];
 		}
+		keys.swap(ws.sortedKeys);
 	}
-	quickHull(left, a, f, hull);
-	
-	// Add f to the hull
-	hull.push_back(f);
 
-	// Collect points to the left of segment (f, b)
-	vector<point> right;
-	for (auto p : v) {
-		if (ccw(f, b, p) > 0) {
-			right.push_back(p);
+	vector<basic_point<T>>& sorted = ws.lower;
+	sorted.resize(v.size());
+	sorted[0] = v[0];
+	for (size_t i = 0; i < m; ++i) {
+		sorted[i + 1] = v[order[i]];
+	}
+	for (size_t first = 0; first < m; ) {
+		size_t last = first + 1;
+		while (last < m && keys[last] == keys[first]) {
+			++last;
+		}
+		// Runs are short, and insertion sort stays in bounds even if
+		// rounding makes before inconsistent. Long runs are usually of
+		// collinear points, for which the orientation tests are slow if
+		// they're exact, so they're only made once per point to check.
+		auto run = sorted.begin() + 1 + first;
+		if (last - first > 16) {
+			if (all_of(run + 1, run + (last - first), [&](const basic_point<T>& p) {
+				return orient(pivot, run[0], p) == 0;
+			})) {
+				stable_sort(run, run + (last - first), nearer);
+			} else {
+				stable_sort(run, run + (last - first), before);
+			}
+		} else {
+			for (size_t i = 1; i < last - first; ++i) {
+				for (size_t j = i; j > 0 && before(run[j], run[j - 1]); --j) {
+					swap(run[j], run[j - 1]);
+				}
+			}
 		}
+		first = last;
 	}
-	quickHull(right, f, b, hull);
+	v.swap(sorted);
 }
 
-// QuickHull algorithm. 
-// https://en.wikipedia.org/wiki/QuickHull
-vector<point> quickHull(const vector<point>& v) {
-	vector<point> hull;
-	
-	// Start with the leftmost and rightmost points.
-	point a = *min_element(v.begin(), v.end(), isLeftOf);
-	point b = *max_element(v.begin(), v.end(), isLeftOf);
+// The orientation test GrahamScan uses unless it's given another. The
+// presort puts float points in their exact order, and a rounded scan
+// can disagree with that order about points nearly in line with the
+// pivot and then keep points inside the hull, so float points get the
+// filtered exact test. Integer points are exact already.
+template <typename T>
+struct GrahamOrientation {
+	typedef Ccw type;
+};
 
-	// Split the points on either side of segment (a, b)
-	vector<point> left, right;
-	for (auto p : v) {
-		ccw(a, b, p) > 0 ? left.push_back(p) : right.push_back(p);
+template <>
+struct GrahamOrientation<float> {
+	typedef ExactCcw type;
+};
+
+// The Graham scan algorithm for convex hull.
+// https://en.wikipedia.org/wiki/Graham_scan
+// Finds the hull of v[0, n) using the buffers in ws, and returns
+// ws.hull.
+// Points are compared with orient, by default GrahamOrientation's.
+// Points collinear with the leftmost point are sorted nearest first,
+// and the scan pops collinear points, so repeated and collinear points
+// are handled.
+template <typename T, typename Orientation = typename GrahamOrientation<T>::type>
+const vector<basic_point<T>>& GrahamScan(const basic_point<T>* in, size_t n, BasicHullWorkspace<T>& ws,
+	Orientation orient = Orientation(), unsigned threadCount = 1) {
+	HULL_TRACE("GrahamScan");
+	vector<basic_point<T>>& v = ws.points;
+	v.assign(in, in + n);
+	vector<basic_point<T>>& hull = ws.hull;
+	hull.clear();
+	if (n == 0) {
+		return hull;
 	}
-	
-	// Be careful to add points to the hull
-	// in the correct order. Add our leftmost point.
-	hull.push_back(a);
 
-	// Add hull points from the left (top)
-	quickHull(left, a, b, hull);
+	// Put our leftmost point at index 0
+	swap(v[0], *min_element(v.begin(), v.end(), isLeftOfSorter()));
 
-	// Add our rightmost point
-	hull.push_back(b);
+	// Sort the rest of the points in clockwise order from our
+	// leftmost point, nearest first along the same ray.
+	const basic_point<T> pivot = v[0];
+	typedef typename Wide<T>::type W;
+	auto distance = [&](const basic_point<T>& p) {
+		return magnitude(W(p.x) - W(pivot.x)) + magnitude(W(p.y) - W(pivot.y));
+	};
+	auto nearer = [&](const basic_point<T>& a, const basic_point<T>& b) {
+		return distance(a) < distance(b);
+	};
+	auto before = [&](const basic_point<T>& a, const basic_point<T>& b) {
+		const auto turn = orient(pivot, a, b);
+		return turn < 0 || (turn == 0 && nearer(a, b));
+	};
+	{
+		HULL_PHASE(sort);
+		// Wider coordinates aren't exact in double, so their keys could
+		// be out of order.
+		if constexpr (sizeof(T) <= 4) {
+			angularSort(v, ws, orient, nearer, threadCount);
+		} else {
+			sort(v.begin() + 1, v.end(), before);
+		}
+	}
 
-	// Add hull points from the right (bottom)
-	quickHull(right, b, a, hull);
+	HULL_PHASE(scan);
+	hull.push_back(v[0]);
+	for (auto it = v.begin() + 1; it != v.end(); ++it) {
+		// Pop off any points that make a convex angle with *it
+		while (hull.size() >= 2 && orient(*(hull.rbegin() + 1), *(hull.rbegin()), *it) >= 0) {
+			hull.pop_back();
+			HULL_COUNT(pops, 1);
+		}
+		hull.push_back(*it);
+	}
 
 	return hull;
 }
 
-vector<point> getPoints() {
-	vector<point> v;
-	
-	const float lo = -100.0;
-	const float hi = 100.0;
+// As above, copying the hull to out, which needs room for n points.
+// Returns the number of hull points.
+size_t GrahamScan(const point* v, size_t n, point* out, HullWorkspace& ws) {
+	const vector<point>& hull = GrahamScan(v, n, ws);
+	copy(hull.begin(), hull.end(), out);
+	return hull.size();
+}
 
-	for (int i = 0; i < 100; ++i) {
-		float x = lo + 
-			static_cast<float>(
-				rand()) / static_cast<float>(RAND_MAX / (hi - lo));
+template <typename T, typename Orientation = typename GrahamOrientation<T>::type>
+vector<basic_point<T>> GrahamScan(const vector<basic_point<T>>& v, Orientation orient = Orientation()) {
+	BasicHullWorkspace<T> ws;
+	GrahamScan(v.data(), v.size(), ws, orient);
+	return move(ws.hull);
+}
 
-		float y = lo + 
-			static_cast<float>(
-				rand()) / static_cast<float>(RAND_MAX / (hi - lo));
+vector<point> GrahamScan(const vector<point>& v) {
+	return GrahamScan(v, ExactCcw());
+}
 
-		v.push_back(point(x, y));
-	}
+vector<point> GrahamScan(const PointSoA& v) {
+	return GrahamScan(toPoints(v));
+}
 
-	return v;
+// GrahamScan, with the radix sort of its presort on threadCount
+// threads.
+vector<point> parallelGrahamScan(const vector<point>& v,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	HullWorkspace ws;
+	GrahamScan(v.data(), v.size(), ws, ExactCcw(), threadCount);
+	return move(ws.hull);
 }
 
-void print(const vector<point>& v) {
-	for (auto p : v) {
-		cout << p.x << ", " << p.y << endl;
+// Returns the index of the vertex t of convex polygon h such that
+// every vertex is on or right of segment (p, t), and the farther one
+// if two are in line with p, for p outside h or equal to one of its
+// vertices. As seen from p, the vertices go up to t and then back
+// down, so binary search finds t in O(log h).
+size_t tangent(const vector<point>& h, const point& p) {
+	const size_t n = h.size();
+	auto isP = [&](size_t i) {
+		return h[i].x == p.x && h[i].y == p.y;
+	};
+	// Whether vertex i is at the top: neither neighbour is left of (p, h[i]).
+	// A copy of p has no turn to anything, so it never is.
+	auto isTop = [&](size_t i) {
+		return !isP(i) && ccw(p, h[i], h[(i + 1) % n]) <= 0 && ccw(p, h[i], h[(i + n - 1) % n]) <= 0;
+	};
+	// The top found may be the nearer of two in line with p.
+	auto farthest = [&](size_t t) {
+		for (size_t i : { (t + 1) % n, (t + n - 1) % n }) {
+			if (!isP(i) && ccw(p, h[t], h[i]) == 0 && len(p, h[i]) > len(p, h[t])) {
+				return i;
+			}
+		}
+		return t;
+	};
+
+	if (n >= 4) {
+		if (isTop(0)) {
+			return farthest(0);
+		}
+
+		// Keep the top within the chain h[a, b], where h[n] is h[0].
+		size_t a = 0;
+		size_t b = n;
+		while (b - a > 1) {
+			const size_t c = (a + b) / 2;
+			if (isTop(c)) {
+				return farthest(c);
+			}
+			const bool upA = ccw(p, h[a], h[a + 1]) > 0;
+			const bool upC = ccw(p, h[c], h[(c + 1) % n]) > 0;
+			const bool aAboveC = ccw(p, h[c], h[a]) > 0;
+			if (upA ? (!upC || aAboveC) : (!upC && !aAboveC)) {
+				b = c;
+			} else {
+				a = c;
+			}
+		}
+		if (isTop(a)) {
+			return farthest(a);
+		}
+		if (isTop(b % n)) {
+			return farthest(b % n);
+		}
 	}
+
+	// Small or degenerate polygons get a linear scan.
+	size_t t = n > 1 && isP(0) ? 1 : 0;
+	for (size_t i = t + 1; i < n; ++i) {
+		const float turn = isP(i) ? -1 : ccw(p, h[t], h[i]);
+		if (turn > 0 || (turn == 0 && len(p, h[i]) > len(p, h[t]))) {
+			t = i;
+		}
+	}
+	return t;
 }
 
-int main() { 	
-	vector<point> v = getPoints();
-	
-	vector<point> h = quickHull(v);
-	cout << "quickHull point count: " << h.size() << endl;
-	print(h);
+// Chan's algorithm for convex hull, which is O(n log h).
+// The points are split into groups of m, and each group's hull is
+// found with GrahamScan. Gift wrapping then steps around the hull,
+// taking the best tangent from the current point to each group's
+// hull. If that doesn't close the hull in m steps, m was smaller
+// than h, so we square it and start over.
+// https://en.wikipedia.org/wiki/Chan%27s_algorithm
+vector<point> chanHull(const vector<point>& v) {
+	HULL_TRACE("chanHull");
+	// There's no leftmost point to start from without any points.
+	if (v.size() < 3) {
+		return v;
+	}
+	for (size_t m = 4; ; m = min(m * m, v.size())) {
+		// Find the hull of each group. GrahamScan needs three points,
+		// and smaller groups are their own hulls anyway.
+		vector<vector<point>> groups;
+		for (size_t i = 0; i < v.size(); i += m) {
+			vector<point> g(v.begin() + i, v.begin() + min(i + m, v.size()));
+			groups.push_back(g.size() < 3 ? g : GrahamScan(g));
+		}
 
- 	h = giftWrapping(v);
-	cout << endl << "giftWrapping point count: " << h.size() << endl;
-	print(h);
+		// Start with the leftmost point, which is the first point of
+		// its group's hull. We track a hull point by its group and
+		// its index within that group's hull.
+		size_t startGroup = 0;
+		for (size_t k = 1; k < groups.size(); ++k) {
+			if (isLeftOf(groups[k][0], groups[startGroup][0])) {
+				startGroup = k;
+			}
+		}
 
-	h = monotoneChain(v);
-	cout << endl << "monotoneChain point count: " << h.size() << endl;
-	print(h);
-	
-	h = GrahamScan(v);
-	cout << endl << "GrahamScan point count: " << h.size() << endl;
+		HULL_PHASE(merge);
+		vector<point> hull;
+		size_t group = startGroup;
+		size_t idx = 0;
+		do {
+			const point p = groups[group][idx];
+			hull.push_back(p);
+
+			// The next point on our own group's hull is a candidate.
+			// For the other groups it's the tangent from p.
+			size_t bestGroup = group;
+			size_t bestIdx = (idx + 1) % groups[group].size();
+			for (size_t k = 0; k < groups.size(); ++k) {
+				if (k == group) {
+					continue;
+				}
+				const size_t t = tangent(groups[k], p);
+				const point& best = groups[bestGroup][bestIdx];
+				const point& q = groups[k][t];
+				const float turn = ccw(p, best, q);
+				// Take the candidate that's farthest ccw, or farthest
+				// away if two are collinear with p.
+				if (turn > 0 || (turn == 0 && len(p, q) > len(p, best))) {
+					bestGroup = k;
+					bestIdx = t;
+				}
+			}
+			group = bestGroup;
+			idx = bestIdx;
+		} while ((group != startGroup || idx != 0) && hull.size() < m);
+
+		if (group == startGroup && idx == 0) {
+			return hull;
+		}
+	}
+}
+
+
+// Adds the points of a sorted range to a monotone chain in turn.
+template <typename Iterator, typename T, typename Orientation = Ccw>
+void addToChain(Iterator first, Iterator last, vector<basic_point<T>>& chain,
+	Orientation orient = Orientation()) {
+	for (auto it = first; it != last; ++it) {
+		// Pop off any points that make a convex angle with *it
+		while (chain.size() >= 2 && orient(*(chain.rbegin() + 1), *(chain.rbegin()), *it) >= 0) {
+			chain.pop_back();
+			HULL_COUNT(pops, 1);
+		}
+		chain.push_back(*it);
+	}
+}
+
+// Maps a float to an unsigned int that sorts in the same order.
+// Negative floats have all their bits flipped, so larger magnitudes
+// come first, and the rest just have their sign bit set. Adding zero
+// turns -0 into 0 first, as ccw and isLeftOf treat them as equal.
+uint32_t sortableBits(float f) {
+	f += 0.0f;
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u ^ ((u >> 31) ? 0xFFFFFFFFu : 0x80000000u);
+}
+
+// The inverse of sortableBits().
+float fromSortableBits(uint32_t u) {
+	u ^= (u >> 31) ? 0x80000000u : 0xFFFFFFFFu;
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+// Sorts keys of keyBits bits with an LSD radix sort, over 11-bit
+// digits with no comparisons, using sorted and counts as scratch.
+// Digits that are the same in every key are skipped.
+void radixSortKeys(vector<uint64_t>& keys, vector<uint64_t>& sorted, vector<size_t>& counts,
+	size_t keyBits) {
+	const size_t digitBits = 11;
+	const size_t digits = (keyBits + digitBits - 1) / digitBits;
+	const size_t buckets = size_t(1) << digitBits;
+	const size_t n = keys.size();
+	sorted.resize(n);
+
+	// Count every digit of every key in one pass.
+	counts.assign(digits * buckets, 0);
+	for (size_t i = 0; i < n; ++i) {
+		const uint64_t key = keys[i];
+		for (size_t d = 0; d < digits; ++d) {
+			++counts[d * buckets + ((key >> (d * digitBits)) & (buckets - 1))];
+		}
+	}
+
+	for (size_t d = 0; d < digits; ++d) {
+		const size_t shift = d * digitBits;
+		size_t* count = &counts[d * buckets];
+		if (n == 0 || count[(keys[0] >> shift) & (buckets - 1)] == n) {
+			continue;
+		}
+		size_t offset = 0;
+		for (size_t b = 0; b < buckets; ++b) {
+			size_t c = count[b];
+			count[b] = offset;
+			offset += c;
+		}
+		for (size_t i = 0; i < n; ++i) {
+			sorted[count[(keys[i] >> shift) & (buckets - 1)]++] = keys[i];
+		}
+		keys.swap(sorted);
+	}
+}
+
+// Sorts points in lexicographic order with radixSortKeys().
+// Each point becomes one 64-bit key, x in the high half and y in the
+// low half, so six passes sort the keys. The coordinates must be
+// finite.
+void radixSort(vector<point>& v, HullWorkspace& ws) {
+	const size_t n = v.size();
+	vector<uint64_t>& keys = ws.keys;
+	keys.resize(n);
+	for (size_t i = 0; i < n; ++i) {
+		keys[i] = (uint64_t(sortableBits(v[i].x)) << 32) | sortableBits(v[i].y);
+	}
+	radixSortKeys(keys, ws.sortedKeys, ws.counts, 64);
+
+	for (size_t i = 0; i < n; ++i) {
+		v[i] = point(fromSortableBits(uint32_t(keys[i] >> 32)), fromSortableBits(uint32_t(keys[i])));
+	}
+}
+
+void radixSort(vector<point>& v) {
+	HullWorkspace ws;
+	radixSort(v, ws);
+}
+
+// The point count above which sortPoints() uses radixSort().
+// Below it, sort() with isLeftOf is faster.
+const size_t radixSortThreshold = 1 << 12;
+
+// Sorts points in lexicographic order, by radixSort() for large
+// inputs and sort() for small ones.
+void sortPoints(vector<point>& v, HullWorkspace& ws) {
+	if (v.size() >= radixSortThreshold) {
+		radixSort(v, ws);
+	} else {
+		sort(v.begin(), v.end(), isLeftOf);
+	}
+}
+
+// Sorts points of other types with sort().
+template <typename T>
+void sortPoints(vector<basic_point<T>>& v, BasicHullWorkspace<T>&) {
+	sort(v.begin(), v.end(), isLeftOfSorter());
+}
+
+// Sorts integer points in lexicographic order. Flipping the sign bits
+// of the coordinates makes them unsigned in the same order, so a point
+// packs into a key, x above y, that is the point itself. Large inputs
+// sort the keys with radixSortKeys() and unpack them, and an int16
+// point's 32-bit key takes three passes.
+template <typename T>
+void sortIntegerPoints(vector<basic_point<T>>& v, BasicHullWorkspace<T>& ws) {
+	if (v.size() < radixSortThreshold) {
+		sort(v.begin(), v.end(), isLeftOfSorter());
+		return;
+	}
+	typedef typename make_unsigned<T>::type U;
+	const size_t bits = 8 * sizeof(T);
+	const U signBit = U(1) << (bits - 1);
+	vector<uint64_t>& keys = ws.keys;
+	keys.resize(v.size());
+	for (size_t i = 0; i < v.size(); ++i) {
+		keys[i] = (uint64_t(U(v[i].x) ^ signBit) << bits) | (U(v[i].y) ^ signBit);
+	}
+	radixSortKeys(keys, ws.sortedKeys, ws.counts, 2 * bits);
+	for (size_t i = 0; i < v.size(); ++i) {
+		v[i] = basic_point<T>(T(U(keys[i] >> bits) ^ signBit), T(U(keys[i]) ^ signBit));
+	}
+}
+
+void sortPoints(vector<spoint>& v, BasicHullWorkspace<int16_t>& ws) {
+	sortIntegerPoints(v, ws);
+}
+
+void sortPoints(vector<ipoint>& v, BasicHullWorkspace<int32_t>& ws) {
+	sortIntegerPoints(v, ws);
+}
+
+// The most points the small-n kernels below handle.
+const size_t smallHullMaxN = 16;
+
+// The comparators of a sorting network for n points, from Batcher's
+// merge exchange (Knuth's Algorithm M), which works for any n. Pairs
+// (first[i], second[i]) are compared in turn.
+struct SortingNetwork {
+	size_t size;
+	unsigned char first[64];
+	unsigned char second[64];
+};
+
+constexpr SortingNetwork sortingNetwork(size_t n) {
+	SortingNetwork network = { 0, { }, { } };
+	size_t t = 0;
+	while ((size_t(1) << t) < n) {
+		++t;
+	}
+	for (size_t p = t > 0 ? size_t(1) << (t - 1) : 0; p > 0; p >>= 1) {
+		size_t q = size_t(1) << (t - 1);
+		size_t r = 0;
+		size_t d = p;
+		for (;;) {
+			for (size_t i = 0; i + d < n; ++i) {
+				if ((i & p) == r) {
+					network.first[network.size] = (unsigned char)i;
+					network.second[network.size] = (unsigned char)(i + d);
+					++network.size;
+				}
+			}
+			if (q == p) {
+				break;
+			}
+			d = q - p;
+			q >>= 1;
+			r = p;
+		}
+	}
+	return network;
+}
+
+// Puts a and b in order by swapping them under a mask. Compilers turn
+// min and max of keys into branches, which mispredict on every other
+// comparator of the network.
+inline void compareExchange(uint64_t& a, uint64_t& b) {
+	const uint64_t swapped = (a ^ b) & (0 - uint64_t(b < a));
+	a ^= swapped;
+	b ^= swapped;
+}
+
+// Runs network N's comparators over keys, unrolled at compile time.
+template <size_t N, size_t... I>
+void sortSmall(uint64_t* keys, index_sequence<I...>) {
+	constexpr SortingNetwork network = sortingNetwork(N);
+	(compareExchange(keys[network.first[I]], keys[network.second[I]]), ...);
+}
+
+// The monotone chain for exactly N points. A sorting network, unrolled
+// and free of branches, sorts the 64-bit keys radixSort() uses, which
+// order points the same way as isLeftOf. The only branches left are in
+// building the chains. Writes the same hull as monotoneChain to out,
+// which may be v, and returns its size.
+template <size_t N>
+size_t smallHull(const point* v, point* out) {
+	static_assert(N >= 3 && N <= smallHullMaxN, "smallHull is for 3 to 16 points");
+	uint64_t keys[N];
+	for (size_t i = 0; i < N; ++i) {
+		keys[i] = uint64_t(sortableBits(v[i].x)) << 32 | sortableBits(v[i].y);
+	}
+	sortSmall<N>(keys, make_index_sequence<sortingNetwork(N).size>());
+	point p[N];
+	for (size_t i = 0; i < N; ++i) {
+		p[i] = point(fromSortableBits(uint32_t(keys[i] >> 32)), fromSortableBits(uint32_t(keys[i])));
+	}
+
+	// Split the points between the two sides of the segment from the
+	// leftmost point to the rightmost, by bumping one count or the
+	// other rather than branching. A chain only keeps points strictly
+	// on its own side, so each is built from those alone.
+	const point& first = p[0];
+	const point& last = p[N - 1];
+	point left[N];
+	point right[N];
+	size_t leftCount = 0;
+	size_t rightCount = 0;
+	for (size_t i = 1; i + 1 < N; ++i) {
+		const float turn = ccw(first, last, p[i]);
+		left[leftCount] = p[i];
+		right[rightCount] = p[i];
+		leftCount += turn > 0;
+		rightCount += turn < 0;
+	}
+
+	// The chain over the left side, then back over the right.
+	point chain[N + 1];
+	size_t k = 0;
+	chain[k++] = first;
+	for (size_t i = 0; i < leftCount; ++i) {
+		while (k >= 2 && ccw(chain[k - 2], chain[k - 1], left[i]) >= 0) {
+			--k;
+			HULL_COUNT(pops, 1);
+		}
+		chain[k++] = left[i];
+	}
+	while (k >= 2 && ccw(chain[k - 2], chain[k - 1], last) >= 0) {
+		--k;
+		HULL_COUNT(pops, 1);
+	}
+	chain[k++] = last;
+	const size_t leftSize = k;
+	for (size_t i = rightCount; i-- > 0; ) {
+		while (k > leftSize && ccw(chain[k - 2], chain[k - 1], right[i]) >= 0) {
+			--k;
+			HULL_COUNT(pops, 1);
+		}
+		chain[k++] = right[i];
+	}
+	while (k > leftSize && ccw(chain[k - 2], chain[k - 1], first) >= 0) {
+		--k;
+		HULL_COUNT(pops, 1);
+	}
+
+	copy(chain, chain + k, out);
+	return k;
+}
+
+typedef size_t (*SmallHullKernel)(const point* v, point* out);
+
+template <size_t... N>
+constexpr array<SmallHullKernel, sizeof...(N)> smallHullKernels(index_sequence<N...>) {
+	return { { (N >= 3 ? smallHull<(N >= 3 ? N : 3)> : nullptr)... } };
+}
+
+// Runs the kernel for n points, for 3 <= n <= smallHullMaxN.
+size_t smallHull(const point* v, size_t n, point* out) {
+	static constexpr array<SmallHullKernel, smallHullMaxN + 1> kernels =
+		smallHullKernels(make_index_sequence<smallHullMaxN + 1>());
+	return kernels[n](v, out);
+}
+
+// The monotone chain algorithm for convex hull.
+// Finds the hull of v[0, n) using the buffers in ws, and returns
+// ws.hull. Points are compared with orient, ccw by default.
+template <typename T, typename Orientation = Ccw>
+const vector<basic_point<T>>& monotoneChain(const basic_point<T>* in, size_t n, BasicHullWorkspace<T>& ws,
+	Orientation orient = Orientation()) {
+	HULL_TRACE("monotoneChain");
+	// One point or none has no upper and lower chains to join.
+	if (n < 2) {
+		ws.hull.assign(in, in + n);
+		return ws.hull;
+	}
+
+	// Take a small-n kernel when there's one.
+	if constexpr (is_same<T, float>::value && is_same<Orientation, Ccw>::value) {
+		if (n >= 3 && n <= smallHullMaxN) {
+			ws.hull.resize(n);
+			ws.hull.resize(smallHull(in, n, ws.hull.data()));
+			return ws.hull;
+		}
+	}
+
+	// Sort our points in lexicographic order.
+	// Sorted input can skip the sort, and checking for it stops at
+	// the first pair out of order.
+	vector<basic_point<T>>& v = ws.points;
+	v.assign(in, in + n);
+	if (!is_sorted(v.begin(), v.end(), isLeftOfSorter())) {
+		HULL_PHASE(sort);
+		sortPoints(v, ws);
+	}
+	
+	// Find the lower half of the convex hull.
+	HULL_PHASE(scan);
+	vector<basic_point<T>>& lower = ws.lower;
+	lower.clear();
+	addToChain(v.begin(), v.end(), lower, orient);
+		
+	// Find the upper half of the convex hull.
+	vector<basic_point<T>>& upper = ws.upper;
+	upper.clear();
+	addToChain(v.rbegin(), v.rend(), upper, orient);
+
+	vector<basic_point<T>>& hull = ws.hull;
+	hull.assign(lower.begin(), lower.end());
+	// Both hulls include both endpoints, so leave them out when we 
+	// append the upper hull.
+	hull.insert(hull.end(), upper.begin() + 1, upper.end() - 1);
+	return hull;
+}
+
+// As above, copying the hull to out, which needs room for n points.
+// Returns the number of hull points.
+size_t monotoneChain(const point* v, size_t n, point* out, HullWorkspace& ws) {
+	const vector<point>& hull = monotoneChain(v, n, ws);
+	copy(hull.begin(), hull.end(), out);
+	return hull.size();
+}
+
+template <typename T, typename Orientation = Ccw>
+vector<basic_point<T>> monotoneChain(const vector<basic_point<T>>& v, Orientation orient = Orientation()) {
+	BasicHullWorkspace<T> ws;
+	monotoneChain(v.data(), v.size(), ws, orient);
+	return move(ws.hull);
+}
+
+vector<point> monotoneChain(const vector<point>& v) {
+	return monotoneChain(v, Ccw());
+}
+
+vector<point> monotoneChain(const PointSoA& v) {
+	return monotoneChain(toPoints(v));
+}
+
+// Maps float points in a known bounding box to a grid of int16 or
+// int32 coordinates and back, for points from a fixed-resolution
+// source. Grid points take half the memory of float points or the
+// same, sort as integer keys, and have exact cross products. Each
+// coordinate moves by at most half a grid step, resolution() / 2.
+// Points outside the box are clamped onto its edge.
+template <typename T>
+class Quantizer {
+public:
+	Quantizer(float xMin, float yMin, float xMax, float yMax)
+		: xMin(xMin), yMin(yMin) {
+		// The most steps of the grid a coordinate can be from the box's
+		// low corner.
+		const double steps = double(numeric_limits<T>::max()) - numeric_limits<T>::min();
+		const double extent = max(double(xMax) - xMin, double(yMax) - yMin);
+		scale = extent > 0 ? steps / extent : 1;
+	}
+
+	// The distance between neighbouring grid points.
+	double resolution() const {
+		return 1 / scale;
+	}
+
+	basic_point<T> quantize(const point& p) const {
+		return basic_point<T>(toGrid(p.x, xMin), toGrid(p.y, yMin));
+	}
+
+	point dequantize(const basic_point<T>& q) const {
+		return point(fromGrid(q.x, xMin), fromGrid(q.y, yMin));
+	}
+
+	vector<basic_point<T>> quantize(const vector<point>& v) const {
+		vector<basic_point<T>> q;
+		q.reserve(v.size());
+		for (auto& p : v) {
+			q.push_back(quantize(p));
+		}
+		return q;
+	}
+
+	vector<point> dequantize(const vector<basic_point<T>>& q) const {
+		vector<point> v;
+		v.reserve(q.size());
+		for (auto& p : q) {
+			v.push_back(dequantize(p));
+		}
+		return v;
+	}
+
+private:
+	T toGrid(float f, float lo) const {
+		const double step = nearbyint((double(f) - lo) * scale) + numeric_limits<T>::min();
+		return T(min(max(step, double(numeric_limits<T>::min())), double(numeric_limits<T>::max())));
+	}
+
+	float fromGrid(T t, float lo) const {
+		return float(lo + (double(t) - numeric_limits<T>::min()) / scale);
+	}
+
+	float xMin;
+	float yMin;
+	// Grid steps per unit.
+	double scale;
+};
+
+// The hull of v on q's grid, with monotoneChain's exact integer
+// orientation tests and integer key sort, mapped back to floats. Its
+// vertices are within q.resolution() of the input points they stand
+// for.
+template <typename T>
+vector<point> quantizedHull(const vector<point>& v, const Quantizer<T>& q) {
+	HULL_TRACE("quantizedHull");
+	return q.dequantize(monotoneChain(q.quantize(v)));
+}
+
+// The monotone chain algorithm, run on several threads.
+// The points are split into one chunk per thread and each thread
+// finds the hull of its chunk. Only points on a chunk's hull can be
+// on the full hull, so one more serial pass over the (small) partial
+// hulls finishes the job. The result is in the same order as
+// monotoneChain. Works on a vector<point> or a PointSoA.
+template <typename Points>
+vector<point> parallelMonotoneChain(const Points& v,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	HULL_TRACE("parallelMonotoneChain");
+	// hardware_concurrency() may return 0 if it can't tell.
+	size_t chunks = max(threadCount, 1u);
+	chunks = min(chunks, max(v.size() / minPointsPerThread, size_t(1)));
+	if (chunks == 1) {
+		return monotoneChain(v);
+	}
+
+	// Find the hull of each chunk on its own thread.
+	vector<vector<point>> partial(chunks);
+	vector<thread> threads;
+	const size_t chunkSize = v.size() / chunks;
+	for (size_t i = 0; i < chunks; ++i) {
+		size_t first = i * chunkSize;
+		size_t last = (i + 1 == chunks) ? v.size() : first + chunkSize;
+		threads.emplace_back([&v, &partial, i, first, last] {
+			partial[i] = monotoneChain(toPoints(v, first, last));
+		});
+	}
+	for (auto& t : threads) {
+		t.join();
+	}
+
+	// Merge the partial hulls.
+	HULL_PHASE(merge);
+	vector<point> candidates;
+	for (auto& h : partial) {
+		candidates.insert(candidates.end(), h.begin(), h.end());
+	}
+	return monotoneChain(candidates);
+}
+
+// A convex hull that takes its points one at a time.
+// Like monotoneChain, it keeps the upper and lower halves of the hull
+// as chains in lexicographic order, but in balanced trees, so a new
+// point is placed in O(log n). Each point leaves a chain at most once,
+// so inserts are amortized O(log n), and reading the hull is O(h).
+class IncrementalHull {
+public:
+	// Adds p. Returns true if p is on the hull afterwards.
+	bool insert(const point& p) {
+		bool onUpper = insertInto(upper, p, 1);
+		bool onLower = insertInto(lower, p, -1);
+		return onUpper || onLower;
+	}
+
+	// The hull, in the same order as monotoneChain.
+	vector<point> hull() const {
+		vector<point> h(upper.begin(), upper.end());
+		// Both chains include both endpoints, so leave them
+		// out when we append the lower chain.
+		if (lower.size() > 2) {
+			h.insert(h.end(), next(lower.rbegin()), prev(lower.rend()));
+		}
+		return h;
+	}
+
+	// The number of points on the hull.
+	size_t size() const {
+		return upper.size() + (lower.size() > 2 ? lower.size() - 2 : 0);
+	}
+
+	bool empty() const {
+		return upper.empty();
+	}
+
+	void clear() {
+		upper.clear();
+		lower.clear();
+	}
+
+private:
+	typedef set<point, isLeftOfSorter> Chain;
+
+	// Adds p to a chain if it's outside it. The chain only keeps points
+	// where it turns cw (turn = 1, the upper chain) or ccw (turn = -1,
+	// the lower chain), so any neighbours p makes convex are removed.
+	static bool insertInto(Chain& chain, const point& p, float turn) {
+		auto after = chain.lower_bound(p);
+		if (after != chain.end() && !isLeftOf(p, *after)) {
+			// We already have p.
+			return false;
+		}
+		if (after != chain.begin() && after != chain.end() &&
+			turn * ccw(*prev(after), p, *after) >= 0) {
+			// p is on our side of the chain, so it's not on the hull.
+			return false;
+		}
+
+		auto it = chain.insert(after, p);
+
+		// Pop off any points that make a convex angle with p,
+		// first to the right of it and then to the left.
+		for (auto r = next(it); r != chain.end() && next(r) != chain.end(); ) {
+			if (turn * ccw(p, *r, *next(r)) < 0) {
+				break;
+			}
+			r = chain.erase(r);
+		}
+		while (it != chain.begin() && prev(it) != chain.begin()) {
+			auto l = prev(it);
+			if (turn * ccw(*prev(l), *l, p) < 0) {
+				break;
+			}
+			chain.erase(l);
+		}
+		return true;
+	}
+
+	Chain upper;
+	Chain lower;
+};
+
+// A convex hull that points can be added to and removed from, for
+// example as a sliding window moves over a stream of points.
+// Points live in the leaves of a segment tree, and each tree node
+// keeps the upper and lower chains of the points below it. The chains
+// of a node are those of its children merged and passed through
+// addToChain, since only points on a child's chain can be on the
+// parent's. An insert or erase touches one leaf and rebuilds the
+// O(log n) nodes above it, each in time linear in its chain length,
+// and the hull at the root is read in O(h).
+class DynamicHull {
+public:
+	DynamicHull() : nodes(2), freeSlots(1, 0) { }
+
+	// Adds p.
+	void insert(const point& p) {
+		if (freeSlots.empty()) {
+			grow();
+		}
+		size_t slot = freeSlots.back();
+		freeSlots.pop_back();
+		slots.insert(make_pair(p, slot));
+
+		Chains& leaf = nodes[capacity() + slot];
+		leaf.upper.assign(1, p);
+		leaf.lower.assign(1, p);
+		update(capacity() + slot);
+	}
+
+	// Removes one copy of p. Returns false if we don't have p.
+	bool erase(const point& p) {
+		auto it = slots.find(p);
+		if (it == slots.end()) {
+			return false;
+		}
+		size_t slot = it->second;
+		slots.erase(it);
+		freeSlots.push_back(slot);
+
+		Chains& leaf = nodes[capacity() + slot];
+		leaf.upper.clear();
+		leaf.lower.clear();
+		update(capacity() + slot);
+		return true;
+	}
+
+	// The hull, in the same order as monotoneChain.
+	vector<point> hull() const {
+		const Chains& root = nodes[1];
+		vector<point> h(root.upper);
+		// Both chains include both endpoints, so leave them
+		// out when we append the lower chain.
+		if (root.lower.size() > 2) {
+			h.insert(h.end(), root.lower.begin() + 1, root.lower.end() - 1);
+		}
+		return h;
+	}
+
+	// The number of points we have, on the hull or not.
+	size_t size() const {
+		return slots.size();
+	}
+
+	bool empty() const {
+		return slots.empty();
+	}
+
+private:
+	// The upper chain runs left to right and the lower chain right
+	// to left, the order monotoneChain builds its two halves in.
+	struct Chains {
+		vector<point> upper;
+		vector<point> lower;
+	};
+
+	size_t capacity() const {
+		return nodes.size() / 2;
+	}
+
+	// Doubles the number of leaves and rebuilds the tree.
+	void grow() {
+		const size_t oldCapacity = capacity();
+		vector<Chains> old;
+		old.swap(nodes);
+		nodes.resize(4 * oldCapacity);
+		for (size_t i = 0; i < oldCapacity; ++i) {
+			nodes[2 * oldCapacity + i] = old[oldCapacity + i];
+		}
+		for (size_t i = 2 * oldCapacity; i-- > oldCapacity; ) {
+			freeSlots.push_back(i);
+		}
+		for (size_t i = 2 * oldCapacity; i-- > 1; ) {
+			rebuild(i);
+		}
+	}
+
+	// Rebuilds the nodes above leaf i.
+	void update(size_t i) {
+		for (i /= 2; i >= 1; i /= 2) {
+			rebuild(i);
+		}
+	}
+
+	// Rebuilds node i from its children.
+	void rebuild(size_t i) {
+		HULL_PHASE(merge);
+		const Chains& left = nodes[2 * i];
+		const Chains& right = nodes[2 * i + 1];
+		Chains& node = nodes[i];
+		if (left.upper.empty() || right.upper.empty()) {
+			node = left.upper.empty() ? right : left;
+			return;
+		}
+
+		merged.clear();
+		merge(left.upper.begin(), left.upper.end(),
+			right.upper.begin(), right.upper.end(), back_inserter(merged), isLeftOf);
+		node.upper.clear();
+		addToChain(merged.begin(), merged.end(), node.upper);
+
+		merged.clear();
+		merge(left.lower.begin(), left.lower.end(),
+			right.lower.begin(), right.lower.end(), back_inserter(merged),
+			[](const point& a, const point& b) { return isLeftOf(b, a); });
+		node.lower.clear();
+		addToChain(merged.begin(), merged.end(), node.lower);
+	}
+
+	// Node 1 is the root, and the children of node i are 2i and 2i + 1.
+	// The leaves are the second half.
+	vector<Chains> nodes;
+	// The leaf slot of each point we have, and the unused slots.
+	multimap<point, size_t, isLeftOfSorter> slots;
+	vector<size_t> freeSlots;
+	// Reused while rebuilding a node.
+	vector<point> merged;
+};
+
+
+// Recursive call of the quickhull algorithm.
+// v[lo, hi) holds the points left of segment (a, b). The range is
+// reordered in place, so no new vectors are needed at any level.
+template <typename T, typename Orientation>
+void quickHull(vector<basic_point<T>>& v, size_t lo, size_t hi, const basic_point<T>& a,
+			   const basic_point<T>& b, vector<basic_point<T>>& hull, Orientation orient) {
+	if (lo == hi) {
+		return;
+	}
+	HULL_DEPTH();
+
+	basic_point<T> f = v[getFarthest(a, b, v, lo, hi, orient)];
+
+	// Partition the range in one pass into three parts:
+	// v[lo, mid) is left of segment (a, f), v[mid, end) is left of
+	// segment (f, b), and v[end, hi) is inside triangle (a, f, b)
+	// and can't be on the hull. No point is left of both segments,
+	// since f is the farthest point from (a, b).
+	size_t mid = lo;
+	size_t end = lo;
+	for (size_t i = lo; i < hi; ++i) {
+		if (orient(a, f, v[i]) > 0) {
+			swap(v[i], v[end]);
+			swap(v[end++], v[mid++]);
+		} else if (orient(f, b, v[i]) > 0) {
+			swap(v[i], v[end++]);
+		}
+	}
+
+	// f is among the points in the triangle, but isn't dropped.
+	HULL_COUNT(partitionDiscards, hi - end - 1);
+
+	// Add hull points left of (a, f), then f, then those left of (f, b).
+	quickHull(v, lo, mid, a, f, hull, orient);
+	hull.push_back(f);
+	quickHull(v, mid, end, f, b, hull, orient);
+}
+
+// QuickHull algorithm. 
+// https://en.wikipedia.org/wiki/QuickHull
+// Finds the hull of v[0, n) using the buffers in ws, and returns
+// ws.hull. Points are compared with orient, ccw by default.
+template <typename T, typename Orientation = Ccw>
+const vector<basic_point<T>>& quickHull(const basic_point<T>* v, size_t n, BasicHullWorkspace<T>& ws,
+	Orientation orient = Orientation()) {
+	HULL_TRACE("quickHull");
+	HULL_PHASE(scan);
+	vector<basic_point<T>>& hull = ws.hull;
+	hull.clear();
+	if (n < 2) {
+		hull.assign(v, v + n);
+		return hull;
+	}
+	
+	// Start with the leftmost and rightmost points.
+	basic_point<T> a = *min_element(v, v + n, isLeftOfSorter());
+	basic_point<T> b = *max_element(v, v + n, isLeftOfSorter());
+
+	// Our one working copy of the points. Split it on either
+	// side of segment (a, b).
+	vector<basic_point<T>>& w = ws.points;
+	w.assign(v, v + n);
+	// Points on the segment, a and b among them, are dropped.
+	// Finding one of them farthest on an empty side would add
+	// a or b to the hull twice.
+	size_t mid = partition(w.begin(), w.end(), [&](const basic_point<T>& p) {
+		return orient(a, b, p) > 0;
+	}) - w.begin();
+	size_t end = partition(w.begin() + mid, w.end(), [&](const basic_point<T>& p) {
+		return orient(a, b, p) < 0;
+	}) - w.begin();
+	// a and b are among the points on the segment, but aren't dropped.
+	HULL_COUNT(partitionDiscards, n - end - min(n - end, size_t(2)));
+	
+	// Be careful to add points to the hull
+	// in the correct order. Add our leftmost point.
+	hull.push_back(a);
+
+	// Add hull points from the left (top)
+	quickHull(w, 0, mid, a, b, hull, orient);
+
+	// Add our rightmost point
+	hull.push_back(b);
+
+	// Add hull points from the right (bottom)
+	quickHull(w, mid, end, b, a, hull, orient);
+
+	return hull;
+}
+
+// As above, copying the hull to out, which needs room for n points.
+// Returns the number of hull points.
+size_t quickHull(const point* v, size_t n, point* out, HullWorkspace& ws) {
+	const vector<point>& hull = quickHull(v, n, ws);
+	copy(hull.begin(), hull.end(), out);
+	return hull.size();
+}
+
+template <typename T, typename Orientation = Ccw>
+vector<basic_point<T>> quickHull(const vector<basic_point<T>>& v, Orientation orient = Orientation()) {
+	BasicHullWorkspace<T> ws;
+	quickHull(v.data(), v.size(), ws, orient);
+	return move(ws.hull);
+}
+
+vector<point> quickHull(const vector<point>& v) {
+	return quickHull(v, Ccw());
+}
+
+// The result of one pass over a range of points against segments
+// (a, f) and (f, b), as done by a side-scan kernel below.
+struct SideScan {
+	// The number of points left of (a, f) and left of (f, b).
+	size_t leftCount;
+	size_t rightCount;
+	// The largest cross product on each side, and its point.
+	float leftMax;
+	float rightMax;
+	point leftFarthest;
+	point rightFarthest;
+
+	SideScan() : leftCount(0), rightCount(0), leftMax(0), rightMax(0),
+		leftFarthest(0, 0), rightFarthest(0, 0) { }
+};
+
+// A side-scan kernel finds, in one pass over x[0, n) and y[0, n),
+// the points left of segment (a, f) and those left of segment (f, b),
+// along with the farthest point on each side. The first are moved to
+// the front of x and y in their original order, and the second are
+// written to rx and ry, which must have room for n points.
+// Every point on either side has a positive cross product relative to
+// its segment. That is proportional to the distance from the segment,
+// so the farthest point is found without a sqrt or divide.
+typedef SideScan (*SideScanKernel)(float* x, float* y, size_t n,
+	const point& a, const point& f, const point& b, float* rx, float* ry);
+
+// Scans x[i, n), y[i, n) one point at a time, adding to s.
+// The SIMD kernels use this for their last few points.
+void scanSidesFrom(float* x, float* y, size_t i, size_t n,
+	const point& a, const point& f, const point& b,
+	float* rx, float* ry, SideScan& s) {
+	const float afx = f.x - a.x;
+	const float afy = f.y - a.y;
+	const float fbx = b.x - f.x;
+	const float fby = b.y - f.y;
+
+	for (; i < n; ++i) {
+		const float px = x[i];
+		const float py = y[i];
+		const float c1 = afx * (py - a.y) - afy * (px - a.x);
+		if (c1 > 0) {
+			if (c1 > s.leftMax) {
+				s.leftMax = c1;
+				s.leftFarthest = point(px, py);
+			}
+			x[s.leftCount] = px;
+			y[s.leftCount++] = py;
+			continue;
+		}
+		const float c2 = fbx * (py - f.y) - fby * (px - f.x);
+		if (c2 > 0) {
+			if (c2 > s.rightMax) {
+				s.rightMax = c2;
+				s.rightFarthest = point(px, py);
+			}
+			rx[s.rightCount] = px;
+			ry[s.rightCount++] = py;
+		}
+	}
+}
+
+// The portable side-scan kernel.
+SideScan scanSidesScalar(float* x, float* y, size_t n,
+	const point& a, const point& f, const point& b, float* rx, float* ry) {
+	SideScan s;
+	scanSidesFrom(x, y, 0, n, a, f, b, rx, ry, s);
+	return s;
+}
+
+// Folds the per-lane maxima of a SIMD kernel into s.
+// On ties the lowest lane wins.
+void reduceLanes(const float* leftMax, const float* leftX, const float* leftY,
+	const float* rightMax, const float* rightX, const float* rightY,
+	size_t lanes, SideScan& s) {
+	for (size_t k = 0; k < lanes; ++k) {
+		if (leftMax[k] > s.leftMax) {
+			s.leftMax = leftMax[k];
+			s.leftFarthest = point(leftX[k], leftY[k]);
+		}
+		if (rightMax[k] > s.rightMax) {
+			s.rightMax = rightMax[k];
+			s.rightFarthest = point(rightX[k], rightY[k]);
+		}
+	}
+}
+
+#if CONVEXHULL_X86_SIMD
+// The AVX2 side-scan kernel, eight points at a time.
+// Sides are found with vector compares and the points are
+// then moved by walking the bits of the compare masks.
+__attribute__((target("avx2")))
+SideScan scanSidesAvx2(float* x, float* y, size_t n,
+	const point& a, const point& f, const point& b, float* rx, float* ry) {
+	const __m256 ax = _mm256_set1_ps(a.x);
+	const __m256 ay = _mm256_set1_ps(a.y);
+	const __m256 fx = _mm256_set1_ps(f.x);
+	const __m256 fy = _mm256_set1_ps(f.y);
+	const __m256 afx = _mm256_set1_ps(f.x - a.x);
+	const __m256 afy = _mm256_set1_ps(f.y - a.y);
+	const __m256 fbx = _mm256_set1_ps(b.x - f.x);
+	const __m256 fby = _mm256_set1_ps(b.y - f.y);
+	const __m256 zero = _mm256_setzero_ps();
+
+	__m256 leftMax = zero, leftX = zero, leftY = zero;
+	__m256 rightMax = zero, rightX = zero, rightY = zero;
+	alignas(32) float bx[8];
+	alignas(32) float by[8];
+
+	SideScan s;
+	size_t i = 0;
+	for (; i + 8 <= n; i += 8) {
+		const __m256 px = _mm256_loadu_ps(x + i);
+		const __m256 py = _mm256_loadu_ps(y + i);
+		const __m256 c1 = _mm256_sub_ps(_mm256_mul_ps(afx, _mm256_sub_ps(py, ay)),
+			_mm256_mul_ps(afy, _mm256_sub_ps(px, ax)));
+		const __m256 c2 = _mm256_sub_ps(_mm256_mul_ps(fbx, _mm256_sub_ps(py, fy)),
+			_mm256_mul_ps(fby, _mm256_sub_ps(px, fx)));
+
+		const __m256 inLeft = _mm256_cmp_ps(c1, zero, _CMP_GT_OQ);
+		const __m256 inRight = _mm256_andnot_ps(inLeft, _mm256_cmp_ps(c2, zero, _CMP_GT_OQ));
+		const __m256 newLeft = _mm256_cmp_ps(c1, leftMax, _CMP_GT_OQ);
+		const __m256 newRight = _mm256_andnot_ps(inLeft, _mm256_cmp_ps(c2, rightMax, _CMP_GT_OQ));
+
+		leftMax = _mm256_blendv_ps(leftMax, c1, newLeft);
+		leftX = _mm256_blendv_ps(leftX, px, newLeft);
+		leftY = _mm256_blendv_ps(leftY, py, newLeft);
+		rightMax = _mm256_blendv_ps(rightMax, c2, newRight);
+		rightX = _mm256_blendv_ps(rightX, px, newRight);
+		rightY = _mm256_blendv_ps(rightY, py, newRight);
+
+		// Copy the block out first, since moving left points to the
+		// front can overwrite it.
+		_mm256_store_ps(bx, px);
+		_mm256_store_ps(by, py);
+		for (unsigned m = _mm256_movemask_ps(inLeft); m != 0; m &= m - 1) {
+			const unsigned k = __builtin_ctz(m);
+			x[s.leftCount] = bx[k];
+			y[s.leftCount++] = by[k];
+		}
+		for (unsigned m = _mm256_movemask_ps(inRight); m != 0; m &= m - 1) {
+			const unsigned k = __builtin_ctz(m);
+			rx[s.rightCount] = bx[k];
+			ry[s.rightCount++] = by[k];
+		}
+	}
+
+	alignas(32) float lm[8], lx[8], ly[8], rm[8], rxs[8], rys[8];
+	_mm256_store_ps(lm, leftMax);
+	_mm256_store_ps(lx, leftX);
+	_mm256_store_ps(ly, leftY);
+	_mm256_store_ps(rm, rightMax);
+	_mm256_store_ps(rxs, rightX);
+	_mm256_store_ps(rys, rightY);
+	reduceLanes(lm, lx, ly, rm, rxs, rys, 8, s);
+
+	scanSidesFrom(x, y, i, n, a, f, b, rx, ry, s);
+	return s;
+}
+
+// The cross product dx * py - dy * px for sixteen points.
+// AVX-512 brings FMA with it, and a fused cross product isn't
+// exactly zero at an endpoint of its own segment. The explicit
+// rounding forms keep the compiler from fusing them.
+__attribute__((target("avx512f")))
+inline __m512 crossAvx512(__m512 dx, __m512 dy, __m512 px, __m512 py) {
+	const __mmask16 all = 0xFFFF;
+	return _mm512_maskz_sub_round_ps(all,
+		_mm512_maskz_mul_round_ps(all, dx, py, _MM_FROUND_CUR_DIRECTION),
+		_mm512_maskz_mul_round_ps(all, dy, px, _MM_FROUND_CUR_DIRECTION),
+		_MM_FROUND_CUR_DIRECTION);
+}
+
+// The AVX-512 side-scan kernel, sixteen points at a time.
+// Points are moved with compressing stores.
+__attribute__((target("avx512f")))
+SideScan scanSidesAvx512(float* x, float* y, size_t n,
+	const point& a, const point& f, const point& b, float* rx, float* ry) {
+	const __m512 ax = _mm512_set1_ps(a.x);
+	const __m512 ay = _mm512_set1_ps(a.y);
+	const __m512 fx = _mm512_set1_ps(f.x);
+	const __m512 fy = _mm512_set1_ps(f.y);
+	const __m512 afx = _mm512_set1_ps(f.x - a.x);
+	const __m512 afy = _mm512_set1_ps(f.y - a.y);
+	const __m512 fbx = _mm512_set1_ps(b.x - f.x);
+	const __m512 fby = _mm512_set1_ps(b.y - f.y);
+	const __m512 zero = _mm512_setzero_ps();
+
+	__m512 leftMax = zero, leftX = zero, leftY = zero;
+	__m512 rightMax = zero, rightX = zero, rightY = zero;
+
+	SideScan s;
+	size_t i = 0;
+	for (; i + 16 <= n; i += 16) {
+		const __m512 px = _mm512_loadu_ps(x + i);
+		const __m512 py = _mm512_loadu_ps(y + i);
+		const __m512 c1 = crossAvx512(afx, afy, _mm512_sub_ps(px, ax), _mm512_sub_ps(py, ay));
+		const __m512 c2 = crossAvx512(fbx, fby, _mm512_sub_ps(px, fx), _mm512_sub_ps(py, fy));
+
+		const __mmask16 inLeft = _mm512_cmp_ps_mask(c1, zero, _CMP_GT_OQ);
+		const __mmask16 notLeft = static_cast<__mmask16>(~inLeft);
+		const __mmask16 inRight = _mm512_mask_cmp_ps_mask(notLeft, c2, zero, _CMP_GT_OQ);
+		const __mmask16 newLeft = _mm512_cmp_ps_mask(c1, leftMax, _CMP_GT_OQ);
+		const __mmask16 newRight = _mm512_mask_cmp_ps_mask(notLeft, c2, rightMax, _CMP_GT_OQ);
+
+		leftMax = _mm512_mask_mov_ps(leftMax, newLeft, c1);
+		leftX = _mm512_mask_mov_ps(leftX, newLeft, px);
+		leftY = _mm512_mask_mov_ps(leftY, newLeft, py);
+		rightMax = _mm512_mask_mov_ps(rightMax, newRight, c2);
+		rightX = _mm512_mask_mov_ps(rightX, newRight, px);
+		rightY = _mm512_mask_mov_ps(rightY, newRight, py);
+
+		// The block is already in registers, so storing left
+		// points over it in place is safe.
+		_mm512_mask_compressstoreu_ps(x + s.leftCount, inLeft, px);
+		_mm512_mask_compressstoreu_ps(y + s.leftCount, inLeft, py);
+		s.leftCount += __builtin_popcount(inLeft);
+		_mm512_mask_compressstoreu_ps(rx + s.rightCount, inRight, px);
+		_mm512_mask_compressstoreu_ps(ry + s.rightCount, inRight, py);
+		s.rightCount += __builtin_popcount(inRight);
+	}
+
+	alignas(64) float lm[16], lx[16], ly[16], rm[16], rxs[16], rys[16];
+	_mm512_store_ps(lm, leftMax);
+	_mm512_store_ps(lx, leftX);
+	_mm512_store_ps(ly, leftY);
+	_mm512_store_ps(rm, rightMax);
+	_mm512_store_ps(rxs, rightX);
+	_mm512_store_ps(rys, rightY);
+	reduceLanes(lm, lx, ly, rm, rxs, rys, 16, s);
+
+	scanSidesFrom(x, y, i, n, a, f, b, rx, ry, s);
+	return s;
+}
+#endif
+
+#if CONVEXHULL_NEON_SIMD
+// The NEON side-scan kernel, four points at a time.
+SideScan scanSidesNeon(float* x, float* y, size_t n,
+	const point& a, const point& f, const point& b, float* rx, float* ry) {
+	const float32x4_t ax = vdupq_n_f32(a.x);
+	const float32x4_t ay = vdupq_n_f32(a.y);
+	const float32x4_t fx = vdupq_n_f32(f.x);
+	const float32x4_t fy = vdupq_n_f32(f.y);
+	const float32x4_t afx = vdupq_n_f32(f.x - a.x);
+	const float32x4_t afy = vdupq_n_f32(f.y - a.y);
+	const float32x4_t fbx = vdupq_n_f32(b.x - f.x);
+	const float32x4_t fby = vdupq_n_f32(b.y - f.y);
+	const float32x4_t zero = vdupq_n_f32(0);
+
+	float32x4_t leftMax = zero, leftX = zero, leftY = zero;
+	float32x4_t rightMax = zero, rightX = zero, rightY = zero;
+	float bx[4], by[4];
+	uint32_t bl[4], br[4];
+
+	SideScan s;
+	size_t i = 0;
+	for (; i + 4 <= n; i += 4) {
+		const float32x4_t px = vld1q_f32(x + i);
+		const float32x4_t py = vld1q_f32(y + i);
+		const float32x4_t c1 = vsubq_f32(vmulq_f32(afx, vsubq_f32(py, ay)),
+			vmulq_f32(afy, vsubq_f32(px, ax)));
+		const float32x4_t c2 = vsubq_f32(vmulq_f32(fbx, vsubq_f32(py, fy)),
+			vmulq_f32(fby, vsubq_f32(px, fx)));
+
+		const uint32x4_t inLeft = vcgtq_f32(c1, zero);
+		const uint32x4_t inRight = vbicq_u32(vcgtq_f32(c2, zero), inLeft);
+		const uint32x4_t newLeft = vcgtq_f32(c1, leftMax);
+		const uint32x4_t newRight = vbicq_u32(vcgtq_f32(c2, rightMax), inLeft);
+
+		leftMax = vbslq_f32(newLeft, c1, leftMax);
+		leftX = vbslq_f32(newLeft, px, leftX);
+		leftY = vbslq_f32(newLeft, py, leftY);
+		rightMax = vbslq_f32(newRight, c2, rightMax);
+		rightX = vbslq_f32(newRight, px, rightX);
+		rightY = vbslq_f32(newRight, py, rightY);
+
+		vst1q_f32(bx, px);
+		vst1q_f32(by, py);
+		vst1q_u32(bl, inLeft);
+		vst1q_u32(br, inRight);
+		for (size_t k = 0; k < 4; ++k) {
+			if (bl[k]) {
+				x[s.leftCount] = bx[k];
+				y[s.leftCount++] = by[k];
+			} else if (br[k]) {
+				rx[s.rightCount] = bx[k];
+				ry[s.rightCount++] = by[k];
+			}
+		}
+	}
+
+	float lm[4], lx[4], ly[4], rm[4], rxs[4], rys[4];
+	vst1q_f32(lm, leftMax);
+	vst1q_f32(lx, leftX);
+	vst1q_f32(ly, leftY);
+	vst1q_f32(rm, rightMax);
+	vst1q_f32(rxs, rightX);
+	vst1q_f32(rys, rightY);
+	reduceLanes(lm, lx, ly, rm, rxs, rys, 4, s);
+
+	scanSidesFrom(x, y, i, n, a, f, b, rx, ry, s);
+	return s;
+}
+#endif
+
+// Picks the best side-scan kernel this CPU supports.
+SideScanKernel selectSideScanKernel() {
+#if CONVEXHULL_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512f")) {
+		return scanSidesAvx512;
+	}
+	if (__builtin_cpu_supports("avx2")) {
+		return scanSidesAvx2;
+	}
+#elif CONVEXHULL_NEON_SIMD
+	return scanSidesNeon;
+#endif
+	return scanSidesScalar;
+}
+
+// The side-scan kernel in use, chosen on first call.
+SideScanKernel sideScanKernel() {
+	static const SideScanKernel kernel = selectSideScanKernel();
+	return kernel;
+}
+
+// Recursive call of the quickhull algorithm on a PointSoA.
+// v[lo, hi) holds the points left of segment (a, b), and f is the
+// farthest of them. Each level is a single side-scan pass, which
+// partitions the range and finds the farthest point of both halves.
+// The points left of (f, b) go through scratch on their way into place.
+void quickHull(PointSoA& v, PointSoA& scratch, size_t lo, size_t hi,
+			   const point& a, const point& b, const point& f,
+			   vector<point>& hull) {
+	if (lo == hi) {
+		return;
+	}
+	HULL_DEPTH();
+
+	SideScan s = sideScanKernel()(v.x.data() + lo, v.y.data() + lo, hi - lo,
+		a, f, b, scratch.x.data(), scratch.y.data());
+
+	const size_t mid = lo + s.leftCount;
+	const size_t end = mid + s.rightCount;
+	HULL_COUNT(ccwCount, 2 * (hi - lo));
+	HULL_COUNT(partitionDiscards, hi - end - 1);
+	copy(scratch.x.begin(), scratch.x.begin() + s.rightCount, v.x.begin() + mid);
+	copy(scratch.y.begin(), scratch.y.begin() + s.rightCount, v.y.begin() + mid);
+
+	quickHull(v, scratch, lo, mid, a, f, s.leftFarthest, hull);
+	hull.push_back(f);
+	quickHull(v, scratch, mid, end, f, b, s.rightFarthest, hull);
+}
+
+// QuickHull algorithm on a PointSoA, using the fastest side-scan
+// kernel for this CPU. Uses the buffers in ws, and returns ws.hull.
+const vector<point>& quickHull(const PointSoA& v, HullWorkspace& ws) {
+	HULL_TRACE("quickHull");
+	HULL_PHASE(scan);
+	vector<point>& hull = ws.hull;
+	hull.clear();
+	if (v.size() < 2) {
+		for (size_t i = 0; i < v.size(); ++i) {
+			hull.push_back(v[i]);
+		}
+		return hull;
+	}
+
+	// Start with the leftmost and rightmost points.
+	size_t idxA = 0;
+	size_t idxB = 0;
+	for (size_t i = 1; i < v.size(); ++i) {
+		if (isLeftOf(v[i], v[idxA])) {
+			idxA = i;
+		}
+		if (isLeftOf(v[idxB], v[i])) {
+			idxB = i;
+		}
+	}
+	point a = v[idxA];
+	point b = v[idxB];
+
+	// Split our working copy on either side of segment (a, b).
+	// Scanning against (a, b) and (b, a) does this in one pass.
+	PointSoA& w = ws.soaPoints;
+	w.x.assign(v.x.begin(), v.x.end());
+	w.y.assign(v.y.begin(), v.y.end());
+	PointSoA& scratch = ws.soaScratch;
+	scratch.x.resize(v.size());
+	scratch.y.resize(v.size());
+	SideScan s = sideScanKernel()(w.x.data(), w.y.data(), w.size(),
+		a, b, a, scratch.x.data(), scratch.y.data());
+	const size_t mid = s.leftCount;
+	const size_t end = mid + s.rightCount;
+	HULL_COUNT(ccwCount, 2 * w.size());
+	HULL_COUNT(partitionDiscards, w.size() - end - min(w.size() - end, size_t(2)));
+	copy(scratch.x.begin(), scratch.x.begin() + s.rightCount, w.x.begin() + mid);
+	copy(scratch.y.begin(), scratch.y.begin() + s.rightCount, w.y.begin() + mid);
+
+	hull.push_back(a);
+	quickHull(w, scratch, 0, mid, a, b, s.leftFarthest, hull);
+	hull.push_back(b);
+	quickHull(w, scratch, mid, end, b, a, s.rightFarthest, hull);
+
+	return hull;
+}
+
+vector<point> quickHull(const PointSoA& v) {
+	HullWorkspace ws;
+	quickHull(v, ws);
+	return move(ws.hull);
+}
+
+// One segment of the segmented quickhull below. Points [lo, hi) are
+// left of segment (a, b), and f is the farthest of them.
+struct HullSegment {
+	size_t lo;
+	size_t hi;
+	point a;
+	point b;
+	point f;
+};
+
+// What one block of points found for one of the segments it covers:
+// the number of its points left of (a, f) and of (f, b), where they
+// start within those children, and the farthest of each.
+struct BlockSegment {
+	size_t segment;
+	size_t count[2];
+	size_t offset[2];
+	float max[2];
+	point farthest[2];
+};
+
+// Points per block of the segmented quickhull.
+const size_t segmentedBlockSize = 1 << 16;
+
+// QuickHull as a sequence of flat data-parallel passes, in the form
+// GPU implementations use, run here on threadCount host threads.
+// Instead of recursing, each level splits every live segment at once.
+// All the points sit in one pair of arrays ordered by segment, and a
+// level is three passes over fixed-size blocks of them: classify each
+// point against its segment's (a, f) and (f, b) while reducing the
+// farthest point of each side, a scan of the per-block counts to place
+// each child segment, and a scatter into the next level's arrays.
+// Returns the same hull, in the same order, as quickHull.
+vector<point> segmentedQuickHull(const PointSoA& v,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	HULL_TRACE("segmentedQuickHull");
+	vector<point> hull;
+	if (v.size() < 2) {
+		for (size_t i = 0; i < v.size(); ++i) {
+			hull.push_back(v[i]);
+		}
+		return hull;
+	}
+
+	// Start with the leftmost and rightmost points.
+	size_t idxA = 0;
+	size_t idxB = 0;
+	for (size_t i = 1; i < v.size(); ++i) {
+		if (isLeftOf(v[i], v[idxA])) {
+			idxA = i;
+		}
+		if (isLeftOf(v[idxB], v[i])) {
+			idxB = i;
+		}
+	}
+	const point a = v[idxA];
+	const point b = v[idxB];
+
+	// The hull in progress, in order, as a list of known hull points
+	// and the live segments between them. Splitting a segment from a
+	// to b with f as its farthest point, against (a, f) and (b, a),
+	// gives the two halves of the hull with b between them.
+	struct HullItem {
+		bool isPoint;
+		point p;
+		size_t segment;
+	};
+	vector<HullItem> items;
+	items.push_back(HullItem{ true, a, 0 });
+	items.push_back(HullItem{ false, point(), 0 });
+	vector<HullSegment> segments(1, HullSegment{ 0, v.size(), a, a, b });
+
+	PointSoA points(v);
+	PointSoA next(v.size());
+	vector<uint8_t> side(v.size());
+	vector<vector<BlockSegment>> blockSegments;
+
+	while (!segments.empty()) {
+		const size_t n = segments.back().hi;
+		const size_t blocks = (n + segmentedBlockSize - 1) / segmentedBlockSize;
+		blockSegments.resize(blocks);
+
+		// Classify each point and find each side's farthest point
+		// within each block. 0 and 1 are the two sides; 2 is neither.
+		parallelFor(blocks, threadCount, [&](size_t block) {
+			const size_t lo = block * segmentedBlockSize;
+			const size_t hi = min(lo + segmentedBlockSize, n);
+			vector<BlockSegment>& found = blockSegments[block];
+			found.clear();
+
+			size_t s = upper_bound(segments.begin(), segments.end(), lo,
+				[](size_t i, const HullSegment& g) { return i < g.lo; }) - segments.begin() - 1;
+			for (size_t i = lo; i < hi; ++i) {
+				while (i >= segments[s].hi) {
+					++s;
+				}
+				if (found.empty() || found.back().segment != s) {
+					found.push_back(BlockSegment{ s, { 0, 0 }, { 0, 0 }, { 0, 0 }, { point(), point() } });
+				}
+				const HullSegment& g = segments[s];
+				const point p = points[i];
+				const float c1 = ccw(g.a, g.f, p);
+				const float c2 = ccw(g.f, g.b, p);
+				const uint8_t k = c1 > 0 ? 0 : (c2 > 0 ? 1 : 2);
+				side[i] = k;
+				if (k < 2) {
+					BlockSegment& bs = found.back();
+					const float c = k == 0 ? c1 : c2;
+					++bs.count[k];
+					if (c > bs.max[k]) {
+						bs.max[k] = c;
+						bs.farthest[k] = p;
+					}
+				}
+			}
+		});
+
+		// Total the blocks' findings for each segment, in block order,
+		// noting where each block's points start within each child.
+		vector<size_t> counts(2 * segments.size(), 0);
+		vector<float> maxes(2 * segments.size(), 0);
+		vector<point> farthest(2 * segments.size());
+		for (auto& found : blockSegments) {
+			for (auto& bs : found) {
+				for (size_t k = 0; k < 2; ++k) {
+					const size_t c = 2 * bs.segment + k;
+					bs.offset[k] = counts[c];
+					counts[c] += bs.count[k];
+					if (bs.max[k] > maxes[c]) {
+						maxes[c] = bs.max[k];
+						farthest[c] = bs.farthest[k];
+					}
+				}
+			}
+		}
+
+		// Lay out the child segments, each in place of its parent.
+		vector<HullSegment> children;
+		vector<size_t> childOf(2 * segments.size(), SIZE_MAX);
+		size_t end = 0;
+		for (size_t s = 0; s < segments.size(); ++s) {
+			const HullSegment& g = segments[s];
+			const point ends[3] = { g.a, g.f, g.b };
+			for (size_t k = 0; k < 2; ++k) {
+				const size_t c = 2 * s + k;
+				if (counts[c] > 0) {
+					childOf[c] = children.size();
+					children.push_back(HullSegment{ end, end + counts[c], ends[k], ends[k + 1], farthest[c] });
+					end += counts[c];
+				}
+			}
+		}
+
+		// Move each point to its child segment.
+		parallelFor(blocks, threadCount, [&](size_t block) {
+			const size_t lo = block * segmentedBlockSize;
+			const size_t hi = min(lo + segmentedBlockSize, n);
+			auto bs = blockSegments[block].begin();
+			size_t at[2] = { 0, 0 };
+			for (size_t i = lo; i < hi; ++i) {
+				if (i >= segments[bs->segment].hi) {
+					++bs;
+					at[0] = at[1] = 0;
+				}
+				const uint8_t k = side[i];
+				if (k < 2) {
+					const size_t j = children[childOf[2 * bs->segment + k]].lo + bs->offset[k] + at[k]++;
+					next.x[j] = points.x[i];
+					next.y[j] = points.y[i];
+				}
+			}
+		});
+		swap(points, next);
+
+		// Replace each segment in the hull with its children and f.
+		vector<HullItem> nextItems;
+		for (const HullItem& item : items) {
+			if (item.isPoint) {
+				nextItems.push_back(item);
+				continue;
+			}
+			const size_t s = item.segment;
+			if (childOf[2 * s] != SIZE_MAX) {
+				nextItems.push_back(HullItem{ false, point(), childOf[2 * s] });
+			}
+			nextItems.push_back(HullItem{ true, segments[s].f, 0 });
+			if (childOf[2 * s + 1] != SIZE_MAX) {
+				nextItems.push_back(HullItem{ false, point(), childOf[2 * s + 1] });
+			}
+		}
+		items.swap(nextItems);
+		segments.swap(children);
+	}
+
+	for (const HullItem& item : items) {
+		hull.push_back(item.p);
+	}
+	return hull;
+}
+
+// A small work-stealing thread pool. Each thread has its own deque of
+// tasks: it pushes and pops its own at the back, and when it runs out
+// it steals from the front of another's, where the oldest and usually
+// largest tasks are. A thread waiting on a group of tasks runs tasks
+// itself until the group is done, so tasks can spawn and wait on more
+// tasks. The thread that makes the pool is its thread 0.
+class WorkStealingPool {
+public:
+	// Tasks spawned into a group, not yet finished.
+	struct Group {
+		atomic<size_t> pending;
+
+		Group() : pending(0) { }
+	};
+
+	explicit WorkStealingPool(unsigned threadCount) : stopping(false) {
+		for (size_t i = 0; i < max(threadCount, 1u); ++i) {
+			queues.emplace_back(new Queue);
+		}
+		workerIndex() = 0;
+		for (size_t i = 1; i < queues.size(); ++i) {
+			workers.emplace_back([this, i] {
+				workerIndex() = i;
+				while (!stopping) {
+					if (!runOne()) {
+						this_thread::yield();
+					}
+				}
+			});
+		}
+	}
+
+	~WorkStealingPool() {
+		stopping = true;
+		for (auto& t : workers) {
+			t.join();
+		}
+	}
+
+	WorkStealingPool(const WorkStealingPool&) = delete;
+	WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+	// Runs f on some thread of the pool, as part of group.
+	void spawn(Group& group, function<void()> f) {
+		++group.pending;
+		Queue& queue = *queues[workerIndex()];
+		lock_guard<mutex> lock(queue.lock);
+		queue.tasks.push_back([&group, f] {
+			f();
+			--group.pending;
+		});
+	}
+
+	// Runs tasks until every task in group has finished.
+	void wait(Group& group) {
+		while (group.pending > 0) {
+			if (!runOne()) {
+				this_thread::yield();
+			}
+		}
+	}
+
+	size_t size() const {
+		return queues.size();
+	}
+
+private:
+	struct Queue {
+		mutex lock;
+		deque<function<void()>> tasks;
+	};
+
+	// This thread's index in the pool it's working for.
+	static size_t& workerIndex() {
+		static thread_local size_t index = 0;
+		return index;
+	}
+
+	// Runs this thread's newest task, or failing that one stolen from
+	// another thread. Returns false if there was none.
+	bool runOne() {
+		const size_t self = workerIndex();
+		function<void()> task;
+		for (size_t i = 0; i < queues.size() && !task; ++i) {
+			Queue& queue = *queues[(self + i) % queues.size()];
+			lock_guard<mutex> lock(queue.lock);
+			if (queue.tasks.empty()) {
+				continue;
+			}
+			if (i == 0) {
+				task = move(queue.tasks.back());
+				queue.tasks.pop_back();
+			} else {
+				task = move(queue.tasks.front());
+				queue.tasks.pop_front();
+			}
+		}
+		if (!task) {
+			return false;
+		}
+		task();
+		return true;
+	}
+
+	vector<unique_ptr<Queue>> queues;
+	vector<thread> workers;
+	atomic<bool> stopping;
+};
+
+// Points below which a parallelQuickHull task finishes its part of the
+// hull itself, with the recursive quickHull.
+const size_t parallelQuickHullGrain = 1 << 15;
+
+// Points per block of a parallelQuickHull pass over a large task.
+const size_t parallelQuickHullBlockSize = 1 << 14;
+
+// One task of parallelQuickHull, and the part of the hull it finds:
+// that of a subtree below the grain in points, or else the farthest
+// point f with the hulls of the two children on either side of it.
+struct QuickHullTask {
+	vector<point> points;
+	point f;
+	unique_ptr<QuickHullTask> left;
+	unique_ptr<QuickHullTask> right;
+
+	// Appends this part of the hull, in order, to hull.
+	void collect(vector<point>& hull) const {
+		if (!left) {
+			hull.insert(hull.end(), points.begin(), points.end());
+			return;
+		}
+		left->collect(hull);
+		hull.push_back(f);
+		right->collect(hull);
+	}
+};
+
+// Calls f(lo, hi) for each block of [first, last) on the pool, and
+// waits for them.
+template <typename Function>
+void forBlocks(WorkStealingPool& pool, size_t first, size_t last, Function f) {
+	WorkStealingPool::Group group;
+	for (size_t lo = first; lo < last; lo += parallelQuickHullBlockSize) {
+		const size_t hi = min(lo + parallelQuickHullBlockSize, last);
+		pool.spawn(group, [=, &f] { f(lo, hi); });
+	}
+	pool.wait(group);
+}
+
+// Copies the points of src[lo, hi) left of segment (a1, b1) to the front
+// of dst[lo, hi), and after them those left of just (a2, b2), keeping
+// their order. Large ranges are split in blocks over the pool: one pass
+// notes each point's side and counts them, and once the counts are
+// summed a second moves the points. Returns the end of each part.
+pair<size_t, size_t> splitPoints(WorkStealingPool& pool, const vector<point>& src, vector<point>& dst,
+	size_t lo, size_t hi, point a1, point b1, point a2, point b2) {
+	const size_t blocks = (hi - lo + parallelQuickHullBlockSize - 1) / parallelQuickHullBlockSize;
+	vector<size_t> firstCounts(blocks + 1, 0);
+	vector<size_t> secondCounts(blocks + 1, 0);
+	// 1 for the first part, 2 for the second, 0 for neither.
+	vector<unsigned char> sides(hi - lo);
+	forBlocks(pool, lo, hi, [&](size_t blo, size_t bhi) {
+		// Local copies, since the stores to sides could alias anything.
+		const point s1a = a1, s1b = b1, s2a = a2, s2b = b2;
+		const point* in = src.data();
+		unsigned char* side = sides.data();
+		size_t first = 0;
+		size_t second = 0;
+		for (size_t i = blo; i < bhi; ++i) {
+			const bool isFirst = ccw(s1a, s1b, in[i]) > 0;
+			const bool isSecond = !isFirst && ccw(s2a, s2b, in[i]) > 0;
+			side[i - lo] = isFirst ? 1 : isSecond ? 2 : 0;
+			first += isFirst;
+			second += isSecond;
+		}
+		const size_t block = (blo - lo) / parallelQuickHullBlockSize;
+		firstCounts[block + 1] = first;
+		secondCounts[block + 1] = second;
+	});
+	for (size_t i = 0; i < blocks; ++i) {
+		firstCounts[i + 1] += firstCounts[i];
+		secondCounts[i + 1] += secondCounts[i];
+	}
+	const size_t mid = lo + firstCounts[blocks];
+	forBlocks(pool, lo, hi, [&](size_t blo, size_t bhi) {
+		const size_t block = (blo - lo) / parallelQuickHullBlockSize;
+		const point* in = src.data();
+		const unsigned char* side = sides.data();
+		point* first = dst.data() + lo + firstCounts[block];
+		point* second = dst.data() + mid + secondCounts[block];
+		for (size_t i = blo; i < bhi; ++i) {
+			if (side[i - lo] == 1) {
+				*first++ = in[i];
+			} else if (side[i - lo] == 2) {
+				*second++ = in[i];
+			}
+		}
+	});
+	return make_pair(mid, mid + secondCounts[blocks]);
+}
+
+// Finds the part of the hull from points src[lo, hi), all left of
+// segment (a, b), into task. Below the grain that's the recursive
+// quickHull. Above it the farthest point is found and the points split
+// across the two children in passes over blocks, and the children run
+// as tasks of their own, swapping src for dst as their scratch space.
+void parallelQuickHull(WorkStealingPool& pool, vector<point>& src, vector<point>& dst,
+	size_t lo, size_t hi, point a, point b, QuickHullTask& task) {
+	if (hi - lo <= parallelQuickHullGrain) {
+		quickHull(src, lo, hi, a, b, task.points, Ccw());
+		return;
+	}
+
+	// The farthest point, taking the first of equals in each block and
+	// across blocks, so the hull doesn't depend on the thread count.
+	const size_t blocks = (hi - lo + parallelQuickHullBlockSize - 1) / parallelQuickHullBlockSize;
+	vector<size_t> farthest(blocks);
+	forBlocks(pool, lo, hi, [&](size_t blo, size_t bhi) {
+		farthest[(blo - lo) / parallelQuickHullBlockSize] = getFarthest(a, b, src, blo, bhi);
+	});
+	size_t idx = farthest[0];
+	for (size_t i = 1; i < blocks; ++i) {
+		if (fabs(ccw(a, b, src[farthest[i]])) > fabs(ccw(a, b, src[idx]))) {
+			idx = farthest[i];
+		}
+	}
+	task.f = src[idx];
+
+	const pair<size_t, size_t> ends = splitPoints(pool, src, dst, lo, hi, a, task.f, task.f, b);
+	task.left.reset(new QuickHullTask);
+	task.right.reset(new QuickHullTask);
+	WorkStealingPool::Group group;
+	pool.spawn(group, [&] {
+		parallelQuickHull(pool, dst, src, lo, ends.first, a, task.f, *task.left);
+	});
+	parallelQuickHull(pool, dst, src, ends.first, ends.second, task.f, b, *task.right);
+	pool.wait(group);
+}
+
+// QuickHull with the recursion run as tasks on a work-stealing pool of
+// threadCount threads, forking wherever a subproblem is above the
+// grain. Threads that run out of work steal the largest tasks left, so
+// the load stays even however unbalanced the recursion is. Each task
+// finds its part of the hull into its own slot in the task tree, and
+// the hull is read from the tree in order at the end, so it is the same
+// for any thread count. Points are in the same order as quickHull gives.
+// Splitting each large task into new arrays moves more memory than
+// quickHull's partitioning in place, so on one thread quickHull is
+// faster.
+vector<point> parallelQuickHull(const vector<point>& v,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	HULL_TRACE("parallelQuickHull");
+	if (v.size() <= parallelQuickHullGrain) {
+		return quickHull(v);
+	}
+
+	const point a = *min_element(v.begin(), v.end(), isLeftOf);
+	const point b = *max_element(v.begin(), v.end(), isLeftOf);
+	WorkStealingPool pool(threadCount);
+	vector<point> src(v);
+	vector<point> dst(v.size());
+
+	// As in quickHull, points on segment (a, b) are dropped.
+	const pair<size_t, size_t> ends = splitPoints(pool, src, dst, 0, src.size(), a, b, b, a);
+	QuickHullTask top;
+	QuickHullTask bottom;
+	WorkStealingPool::Group group;
+	pool.spawn(group, [&] {
+		parallelQuickHull(pool, dst, src, 0, ends.first, a, b, top);
+	});
+	parallelQuickHull(pool, dst, src, ends.first, ends.second, b, a, bottom);
+	pool.wait(group);
+
+	vector<point> hull;
+	hull.push_back(a);
+	top.collect(hull);
+	hull.push_back(b);
+	bottom.collect(hull);
+	return hull;
+}
+
+// A hull algorithm that writes to a caller's array, like the
+// overloads taking a HullWorkspace and an output array above.
+typedef size_t (*HullFunction)(const point* v, size_t n, point* out, HullWorkspace& ws);
+
+// Sets handed to a thread at a time by batchHulls.
+const size_t setsPerTask = 64;
+
+// Finds the hulls of many point sets in one call. Set i is
+// points[offsets[i], offsets[i + 1]), so offsets has one more entry
+// than there are sets. Its hull is left in
+// hulls[hullOffsets[i], hullOffsets[i + 1]). Threads take sets a
+// block at a time, each with its own workspace, and write each hull
+// over the space of its own set, so no set allocates. Sets of fewer
+// than three points are their own hulls.
+void batchHulls(const vector<point>& points, const vector<size_t>& offsets,
+	vector<point>& hulls, vector<size_t>& hullOffsets,
+	HullFunction algorithm = monotoneChain,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	HULL_TRACE("batchHulls");
+	const size_t sets = offsets.empty() ? 0 : offsets.size() - 1;
+	hulls.resize(points.size());
+	hullOffsets.resize(sets + 1);
+
+	// Find the hulls, with hullOffsets[i + 1] holding the size of hull i.
+	atomic<size_t> nextSet(0);
+	auto work = [&] {
+		HullWorkspace ws;
+		for (size_t first; (first = nextSet.fetch_add(setsPerTask)) < sets; ) {
+			for (size_t i = first; i < min(first + setsPerTask, sets); ++i) {
+				const point* v = points.data() + offsets[i];
+				const size_t n = offsets[i + 1] - offsets[i];
+				point* out = hulls.data() + offsets[i];
+				hullOffsets[i + 1] = n < 3 ? copy(v, v + n, out) - out : algorithm(v, n, out, ws);
+			}
+		}
+	};
+	const size_t threads = min<size_t>(max(threadCount, 1u), (sets + setsPerTask - 1) / setsPerTask);
+	vector<thread> pool;
+	for (size_t t = 1; t < threads; ++t) {
+		pool.emplace_back(work);
+	}
+	work();
+	for (auto& t : pool) {
+		t.join();
+	}
+
+	// Close up the gaps between the hulls.
+	size_t end = 0;
+	hullOffsets[0] = 0;
+	for (size_t i = 0; i < sets; ++i) {
+		const size_t first = offsets[i];
+		const size_t count = hullOffsets[i + 1];
+		copy(hulls.begin() + first, hulls.begin() + first + count, hulls.begin() + end);
+		end += count;
+		hullOffsets[i + 1] = end;
+	}
+	hulls.resize(end);
+}
+
+// The algorithms convexHull can run. Auto picks one from the input.
+enum class Algorithm {
+	Auto,
+	GiftWrapping,
+	GrahamScan,
+	MonotoneChain,
+	QuickHull,
+	Chan,
+};
+
+// The most points chooseAlgorithm looks at, and the fewest. It takes
+// one in eight below the most, so its cost stays small next to
+// hulling the smaller inputs.
+const size_t selectorSampleSize = 64;
+const size_t selectorMinSampleSize = 16;
+
+// The thresholds below are from --bench and timing the same cases on
+// sorted input. When most points are on the hull, quickHull recurses
+// once per hull point and GrahamScan wins up to about 4000 points,
+// monotoneChain after that. Otherwise quickHull wins at every size,
+// and from about 4000 points its PointSoA form is faster even counting
+// the conversion. monotoneChain skips its sort on sorted input, which
+// only beats quickHull on the smaller inputs. Gift wrapping and Chan's
+// algorithm never win, so Auto doesn't choose them. Even 16 uniform
+// points have under half on their hull on average, well short of the
+// hull fraction that counts as most.
+const double selectorHullFraction = 0.75;
+const size_t selectorGrahamMaxN = 4096;
+const size_t selectorSortedMaxN = 2048;
+const size_t selectorSoAMinN = 4096;
+
+// Picks the algorithm likely to be fastest on v from an evenly spaced
+// sample of it: the fraction of the sample on the sample's hull
+// estimates h / n, and checking neighbouring points of the sample
+// tells whether v looks sorted.
+Algorithm chooseAlgorithm(const vector<point>& v) {
+	// monotoneChain has kernels for the smallest inputs.
+	const size_t n = v.size();
+	if (n <= smallHullMaxN) {
+		return Algorithm::MonotoneChain;
+	}
+
+	const size_t k = min(n, max(selectorMinSampleSize, min(n / 8, selectorSampleSize)));
+	point sample[selectorSampleSize];
+	bool sorted = true;
+	for (size_t i = 0; i < k; ++i) {
+		const size_t j = i * (n - 1) / (k - 1);
+		sample[i] = v[j];
+		if (j + 1 < n && isLeftOf(v[j + 1], v[j])) {
+			sorted = false;
+		}
+	}
+	if (sorted && n <= selectorSortedMaxN) {
+		return Algorithm::MonotoneChain;
+	}
+
+	// Count the sample's hull points with the monotone chain.
+	sort(sample, sample + k, isLeftOf);
+	vector<point> chain;
+	chain.reserve(k);
+	addToChain(sample, sample + k, chain);
+	size_t hullSize = chain.size() - 1;
+	chain.clear();
+	addToChain(reverse_iterator<point*>(sample + k), reverse_iterator<point*>(sample), chain);
+	hullSize += chain.size() - 1;
+
+	if (double(hullSize) / k >= selectorHullFraction) {
+		return n <= selectorGrahamMaxN ? Algorithm::GrahamScan : Algorithm::MonotoneChain;
+	}
+	return Algorithm::QuickHull;
+}
+
+// Finds the hull of v with algorithm a, in the order that algorithm
+// gives, or with the one chooseAlgorithm picks for Auto. Fewer than
+// three points are returned as they are.
+vector<point> convexHull(const vector<point>& v, Algorithm a = Algorithm::Auto) {
+	if (v.size() < 3) {
+		return v;
+	}
+	if (a == Algorithm::Auto) {
+		a = chooseAlgorithm(v);
+	}
+	switch (a) {
+	case Algorithm::GiftWrapping:
+		return giftWrapping(v);
+	case Algorithm::GrahamScan:
+		return GrahamScan(v);
+	case Algorithm::Chan:
+		return chanHull(v);
+	case Algorithm::QuickHull:
+		if (v.size() >= selectorSoAMinN) {
+			return quickHull(PointSoA(v));
+		}
+		return quickHull(v);
+	default:
+		return monotoneChain(v);
+	}
+}
+
+// The Akl-Toussaint heuristic, a prefilter for any of the algorithms.
+// The extreme points in eight directions make a convex octagon whose
+// strictly interior points can't be on the hull. Puts the other
+// points in kept, which may be a vector<point> or a PointSoA.
+// https://en.wikipedia.org/wiki/Convex_hull_algorithms#Akl%E2%80%93Toussaint_heuristic
+template <typename Points, typename Kept>
+void aklToussaint(const Points& v, Kept& kept) {
+	kept.clear();
+	if (v.size() == 0) {
+		return;
+	}
+
+	// Find the extremes along x, y, x + y and x - y, in ccw order
+	// starting from the leftmost point.
+	const point p0 = v[0];
+	point ext[8] = { p0, p0, p0, p0, p0, p0, p0, p0 };
+	for (size_t i = 1; i < v.size(); ++i) {
+		const point p = v[i];
+		if (p.x < ext[0].x) ext[0] = p;
+		if (p.x + p.y < ext[1].x + ext[1].y) ext[1] = p;
+		if (p.y < ext[2].y) ext[2] = p;
+		if (p.x - p.y > ext[3].x - ext[3].y) ext[3] = p;
+		if (p.x > ext[4].x) ext[4] = p;
+		if (p.x + p.y > ext[5].x + ext[5].y) ext[5] = p;
+		if (p.y > ext[6].y) ext[6] = p;
+		if (p.x - p.y < ext[7].x - ext[7].y) ext[7] = p;
+	}
+
+	// The edges of the octagon, in arrays rather than vectors so the
+	// workspace forms of the algorithms don't allocate here. Extremes
+	// in neighbouring directions are often the same point, so skip the
+	// empty edges.
+	point from[8], to[8];
+	size_t edges = 0;
+	for (size_t i = 0; i < 8; ++i) {
+		const point& a = ext[i];
+		const point& b = ext[(i + 1) % 8];
+		if (a.x != b.x || a.y != b.y) {
+			from[edges] = a;
+			to[edges++] = b;
+		}
+	}
+
+	// Keep any point that isn't strictly ccw of every edge.
+	for (size_t i = 0; i < v.size(); ++i) {
+		const point p = v[i];
+		bool inside = edges > 0;
+		for (size_t e = 0; inside && e < edges; ++e) {
+			inside = ccw(from[e], to[e], p) > 0;
+		}
+		if (!inside) {
+			kept.push_back(p);
+		}
+	}
+
+	HULL_COUNT(prefilterDiscards, v.size() - kept.size());
+}
+
+// As above, returning the points kept, and the number dropped in
+// culled if it's given.
+template <typename Points>
+Points aklToussaint(const Points& v, size_t* culled = nullptr) {
+	Points kept;
+	aklToussaint(v, kept);
+	if (culled) {
+		*culled = v.size() - kept.size();
+	}
+	return kept;
+}
+
+// A wrapping kernel returns the index of the next hull point after p
+// among the count points (x[i], y[i]): the one that no other point is
+// cw of, as seen from p, and the farthest from p, by L1 distance, of
+// any collinear with it. count must be at least 1.
+typedef size_t (*WrapKernel)(const float* x, const float* y, size_t count, const point& p);
+
+// Whether q should replace best as the next hull point after p.
+bool wrapsBefore(const point& p, const point& q, const point& best) {
+	const float turn = ccw(p, q, best);
+	return turn < 0 || (turn == 0 &&
+		fabs(q.x - p.x) + fabs(q.y - p.y) > fabs(best.x - p.x) + fabs(best.y - p.y));
+}
+
+// The portable wrapping kernel.
+size_t wrapScalar(const float* x, const float* y, size_t count, const point& p) {
+	size_t best = 0;
+	for (size_t i = 1; i < count; ++i) {
+		if (wrapsBefore(p, point(x[i], y[i]), point(x[best], y[best]))) {
+			best = i;
+		}
+	}
+	return best;
+}
+
+#if CONVEXHULL_X86_SIMD
+// The AVX2 wrapping kernel. Each of eight lanes keeps the best of its
+// own points, and the lanes' bests are reduced at the end. The cross
+// products and distances are rounded as wrapsBefore rounds them.
+__attribute__((target("avx2")))
+size_t wrapAvx2(const float* x, const float* y, size_t count, const point& p) {
+	if (count < 16) {
+		return wrapScalar(x, y, count, p);
+	}
+	const __m256 px = _mm256_set1_ps(p.x);
+	const __m256 py = _mm256_set1_ps(p.y);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+	__m256 bestX = _mm256_sub_ps(_mm256_loadu_ps(x), px);
+	__m256 bestY = _mm256_sub_ps(_mm256_loadu_ps(y), py);
+	__m256 bestD = _mm256_add_ps(_mm256_and_ps(bestX, absMask), _mm256_and_ps(bestY, absMask));
+	__m256i bestI = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i index = bestI;
+	const __m256i eight = _mm256_set1_epi32(8);
+
+	size_t i = 8;
+	for (; i + 8 <= count; i += 8) {
+		index = _mm256_add_epi32(index, eight);
+		const __m256 qx = _mm256_sub_ps(_mm256_loadu_ps(x + i), px);
+		const __m256 qy = _mm256_sub_ps(_mm256_loadu_ps(y + i), py);
+		const __m256 qd = _mm256_add_ps(_mm256_and_ps(qx, absMask), _mm256_and_ps(qy, absMask));
+		const __m256 turn = _mm256_sub_ps(_mm256_mul_ps(qx, bestY), _mm256_mul_ps(qy, bestX));
+		const __m256 take = _mm256_or_ps(_mm256_cmp_ps(turn, zero, _CMP_LT_OQ),
+			_mm256_and_ps(_mm256_cmp_ps(turn, zero, _CMP_EQ_OQ), _mm256_cmp_ps(qd, bestD, _CMP_GT_OQ)));
+		bestX = _mm256_blendv_ps(bestX, qx, take);
+		bestY = _mm256_blendv_ps(bestY, qy, take);
+		bestD = _mm256_blendv_ps(bestD, qd, take);
+		bestI = _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(bestI),
+			_mm256_castsi256_ps(index), take));
+	}
+	HULL_COUNT(ccwCount, i - 8);
+
+	alignas(32) int32_t lanes[8];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), bestI);
+	size_t best = lanes[0];
+	for (size_t k = 1; k < 8; ++k) {
+		if (wrapsBefore(p, point(x[lanes[k]], y[lanes[k]]), point(x[best], y[best]))) {
+			best = lanes[k];
+		}
+	}
+	for (; i < count; ++i) {
+		if (wrapsBefore(p, point(x[i], y[i]), point(x[best], y[best]))) {
+			best = i;
+		}
+	}
+	return best;
+}
+#endif
+
+// Picks the best wrapping kernel this CPU supports.
+WrapKernel selectWrapKernel() {
+#if CONVEXHULL_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return wrapAvx2;
+	}
+#endif
+	return wrapScalar;
+}
+
+// The wrapping kernel in use, chosen on first call.
+WrapKernel wrapKernel() {
+	static const WrapKernel kernel = selectWrapKernel();
+	return kernel;
+}
+
+// Gift wrapping over the points aklToussaint keeps, which on most
+// inputs are a small fraction of v. The candidates go in a PointSoA,
+// so each step streams two float arrays through wrapKernel rather than
+// walking every point. Gives the hull in the same order giftWrapping
+// does. Points may be a vector<point> or a PointSoA.
+template <typename Points>
+const vector<point>& prunedGiftWrapping(const Points& v, HullWorkspace& ws) {
+	HULL_TRACE("prunedGiftWrapping");
+	vector<point>& hull = ws.hull;
+	hull.clear();
+	PointSoA& c = ws.soaPoints;
+	aklToussaint(v, c);
+	const size_t m = c.size();
+	if (m < 2) {
+		for (size_t i = 0; i < m; ++i) {
+			hull.push_back(c[i]);
+		}
+		return hull;
+	}
+
+	size_t start = 0;
+	for (size_t i = 1; i < m; ++i) {
+		if (isLeftOf(c[i], c[start])) {
+			start = i;
+		}
+	}
+
+	// As in giftWrapping, stop when we see our first point again, or
+	// after m points in case rounding keeps us from getting back to it.
+	HULL_PHASE(scan);
+	const WrapKernel next = wrapKernel();
+	point p = c[start];
+	do {
+		hull.push_back(p);
+		p = c[next(c.x.data(), c.y.data(), m, p)];
+	} while ((p.x != hull[0].x || p.y != hull[0].y) && hull.size() < m);
+
+	return hull;
+}
+
+// As above, for the points v[0, n).
+const vector<point>& prunedGiftWrapping(const point* v, size_t n, HullWorkspace& ws) {
+	ws.points.assign(v, v + n);
+	return prunedGiftWrapping(ws.points, ws);
+}
+
+vector<point> prunedGiftWrapping(const vector<point>& v) {
+	HullWorkspace ws;
+	prunedGiftWrapping(v, ws);
+	return move(ws.hull);
+}
+
+vector<point> prunedGiftWrapping(const PointSoA& v) {
+	HullWorkspace ws;
+	prunedGiftWrapping(v, ws);
+	return move(ws.hull);
+}
+
+// The default number of strips approximateHull uses.
+const size_t approximateHullStrips = 256;
+
+// An approximate hull in O(n + k log k), after Bentley, Faust and
+// Preparata. [xMin, xMax] is split into k strips of equal width, and
+// one pass over the points keeps the lowest and highest point in each
+// strip, and the leftmost and rightmost points. Their hull, from
+// monotoneChain, is that of at most 2k + 2 points. Its vertices are
+// input points, so it lies inside the exact hull, and every point
+// outside it is within (xMax - xMin) / k of it. Points outside
+// [xMin, xMax] go in the end strips, which then don't keep that bound.
+// Uses the buffers in ws, and returns ws.hull.
+const vector<point>& approximateHull(const point* v, size_t n, size_t k,
+	float xMin, float xMax, HullWorkspace& ws) {
+	HULL_TRACE("approximateHull");
+	k = max(k, size_t(1));
+	vector<point>& lowest = ws.lower;
+	vector<point>& highest = ws.upper;
+	lowest.assign(k, point(0, INFINITY));
+	highest.assign(k, point(0, -INFINITY));
+	const float scale = xMax > xMin ? k / (xMax - xMin) : 0;
+
+	point left = n ? v[0] : point();
+	point right = left;
+	{
+		HULL_PHASE(scan);
+		for (size_t i = 0; i < n; ++i) {
+			const point p = v[i];
+			const float offset = (p.x - xMin) * scale;
+			const size_t s = offset < 1 ? 0 : offset >= k ? k - 1 : size_t(offset);
+			if (p.y < lowest[s].y) {
+				lowest[s] = p;
+			}
+			if (p.y > highest[s].y) {
+				highest[s] = p;
+			}
+			if (isLeftOf(p, left)) {
+				left = p;
+			}
+			if (isLeftOf(right, p)) {
+				right = p;
+			}
+		}
+	}
+
+	vector<point>& kept = ws.merged;
+	kept.clear();
+	if (n) {
+		kept.push_back(left);
+		kept.push_back(right);
+	}
+	for (size_t s = 0; s < k; ++s) {
+		if (lowest[s].y <= highest[s].y) {
+			kept.push_back(lowest[s]);
+			kept.push_back(highest[s]);
+		}
+	}
+	HULL_COUNT(prefilterDiscards, n - min(n, kept.size()));
+
+	// Drop repeats, which monotoneChain doesn't expect.
+	sort(kept.begin(), kept.end(), isLeftOf);
+	kept.erase(unique(kept.begin(), kept.end(), [](const point& a, const point& b) {
+		return a.x == b.x && a.y == b.y;
+	}), kept.end());
+	if (kept.size() < 3) {
+		ws.hull.assign(kept.begin(), kept.end());
+		return ws.hull;
+	}
+	return monotoneChain(kept.data(), kept.size(), ws);
+}
+
+// As above, over the points' own range of x, which takes one more
+// pass to find.
+const vector<point>& approximateHull(const point* v, size_t n, size_t k, HullWorkspace& ws) {
+	float xMin = n ? v[0].x : 0;
+	float xMax = xMin;
+	for (size_t i = 1; i < n; ++i) {
+		xMin = min(xMin, v[i].x);
+		xMax = max(xMax, v[i].x);
+	}
+	return approximateHull(v, n, k, xMin, xMax, ws);
+}
+
+vector<point> approximateHull(const vector<point>& v, size_t k = approximateHullStrips) {
+	HullWorkspace ws;
+	approximateHull(v.data(), v.size(), k, ws);
+	return move(ws.hull);
+}
+
+// Whether p is in or on the convex polygon h[0, n), for n >= 3, with
+// its vertices in ccw order. The triangles (h[0], h[k], h[k + 1]) fan
+// out from h[0], so binary search finds the one p could be in, and p
+// is inside if it's left of that triangle's far edge. The search runs
+// the same number of steps for every p, which lets the SIMD kernels
+// run it for several points at once.
+bool containsFan(const point* h, size_t n, const point& p) {
+	if (ccw(h[0], h[1], p) < 0 || ccw(h[0], h[n - 1], p) > 0) {
+		return false;
+	}
+	// The last k in [1, n - 2] with p on or left of (h[0], h[k]).
+	size_t base = 1;
+	for (size_t len = n - 2; len > 1; ) {
+		const size_t half = len / 2;
+		if (ccw(h[0], h[base + half], p) >= 0) {
+			base += half;
+		}
+		len -= half;
+	}
+	return ccw(h[base], h[base + 1], p) >= 0;
+}
+
+// A containment kernel sets inside[i] to whether point (x[i], y[i])
+// is in or on the convex polygon h[0, n), for each of count points,
+// as containsFan does. n must be at least 3.
+typedef void (*ContainsKernel)(const point* h, size_t n,
+	const float* x, const float* y, size_t count, uint8_t* inside);
+
+// The portable containment kernel.
+void containsScalar(const point* h, size_t n,
+	const float* x, const float* y, size_t count, uint8_t* inside) {
+	for (size_t i = 0; i < count; ++i) {
+		inside[i] = containsFan(h, n, point(x[i], y[i]));
+	}
+}
+
+#if CONVEXHULL_X86_SIMD
+// The AVX2 containment kernel, eight points at a time. Each step of
+// the binary search gathers the fan vertex of every lane. The cross
+// products are rounded as ccw rounds them, so the answers match
+// containsScalar's.
+__attribute__((target("avx2")))
+void containsAvx2(const point* h, size_t n,
+	const float* x, const float* y, size_t count, uint8_t* inside) {
+	const float* hx = &h[0].x;
+	const float* hy = &h[0].y;
+	const __m256 x0 = _mm256_set1_ps(h[0].x);
+	const __m256 y0 = _mm256_set1_ps(h[0].y);
+	const __m256 firstX = _mm256_set1_ps(h[1].x - h[0].x);
+	const __m256 firstY = _mm256_set1_ps(h[1].y - h[0].y);
+	const __m256 lastX = _mm256_set1_ps(h[n - 1].x - h[0].x);
+	const __m256 lastY = _mm256_set1_ps(h[n - 1].y - h[0].y);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256i one = _mm256_set1_epi32(1);
+
+	size_t i = 0;
+	for (; i + 8 <= count; i += 8) {
+		const __m256 px = _mm256_loadu_ps(x + i);
+		const __m256 py = _mm256_loadu_ps(y + i);
+		const __m256 dx = _mm256_sub_ps(px, x0);
+		const __m256 dy = _mm256_sub_ps(py, y0);
+
+		const __m256 c1 = _mm256_sub_ps(_mm256_mul_ps(firstX, dy), _mm256_mul_ps(firstY, dx));
+		const __m256 c2 = _mm256_sub_ps(_mm256_mul_ps(lastX, dy), _mm256_mul_ps(lastY, dx));
+		__m256 in = _mm256_and_ps(_mm256_cmp_ps(c1, zero, _CMP_GE_OQ), _mm256_cmp_ps(c2, zero, _CMP_LE_OQ));
+
+		__m256i base = one;
+		for (size_t len = n - 2; len > 1; ) {
+			const size_t half = len / 2;
+			const __m256i k = _mm256_add_epi32(base, _mm256_set1_epi32(static_cast<int>(half)));
+			const __m256 kx = _mm256_sub_ps(_mm256_i32gather_ps(hx, k, 8), x0);
+			const __m256 ky = _mm256_sub_ps(_mm256_i32gather_ps(hy, k, 8), y0);
+			const __m256 c = _mm256_sub_ps(_mm256_mul_ps(kx, dy), _mm256_mul_ps(ky, dx));
+			const __m256i step = _mm256_and_si256(_mm256_castps_si256(_mm256_cmp_ps(c, zero, _CMP_GE_OQ)),
+				_mm256_set1_epi32(static_cast<int>(half)));
+			base = _mm256_add_epi32(base, step);
+			len -= half;
+		}
+
+		const __m256i next = _mm256_add_epi32(base, one);
+		const __m256 ax = _mm256_i32gather_ps(hx, base, 8);
+		const __m256 ay = _mm256_i32gather_ps(hy, base, 8);
+		const __m256 ex = _mm256_sub_ps(_mm256_i32gather_ps(hx, next, 8), ax);
+		const __m256 ey = _mm256_sub_ps(_mm256_i32gather_ps(hy, next, 8), ay);
+		const __m256 c = _mm256_sub_ps(_mm256_mul_ps(ex, _mm256_sub_ps(py, ay)),
+			_mm256_mul_ps(ey, _mm256_sub_ps(px, ax)));
+		in = _mm256_and_ps(in, _mm256_cmp_ps(c, zero, _CMP_GE_OQ));
+
+		const int mask = _mm256_movemask_ps(in);
+		for (size_t k = 0; k < 8; ++k) {
+			inside[i + k] = (mask >> k) & 1;
+		}
+	}
+
+	containsScalar(h, n, x + i, y + i, count - i, inside + i);
+}
+#endif
+
+// Picks the best containment kernel this CPU supports.
+ContainsKernel selectContainsKernel() {
+#if CONVEXHULL_X86_SIMD
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return containsAvx2;
+	}
+#endif
+	return containsScalar;
+}
+
+// The containment kernel in use, chosen on first call.
+ContainsKernel containsKernel() {
+	static const ContainsKernel kernel = selectContainsKernel();
+	return kernel;
+}
+
+// Whether p is on segment (a, b).
+bool onSegment(const point& a, const point& b, const point& p) {
+	return ccw(a, b, p) == 0 &&
+		min(a.x, b.x) <= p.x && p.x <= max(a.x, b.x) &&
+		min(a.y, b.y) <= p.y && p.y <= max(a.y, b.y);
+}
+
+// Answers queries about a convex polygon in O(log h) each, for example
+// about a hull that many points are tested against. It's built from
+// the output of any of the algorithms, in either order. The vertices
+// are kept in ccw order from the leftmost one, so the lower chain runs
+// from vertex 0 to the rightmost vertex and the upper chain runs from
+// there back to vertex 0. Points on the boundary count as inside.
+class HullIndex {
+public:
+	HullIndex() : rightmost(0) { }
+
+	explicit HullIndex(const vector<point>& hull) {
+		assign(hull);
+	}
+
+	// Replaces the polygon with hull, reusing our buffer.
+	void assign(const vector<point>& hull) {
+		v.assign(hull.begin(), hull.end());
+		rightmost = 0;
+		if (v.size() < 3) {
+			return;
+		}
+
+		double area = 0;
+		for (size_t i = 0; i < v.size(); ++i) {
+			const point& a = v[i];
+			const point& b = v[(i + 1) % v.size()];
+			area += double(a.x) * b.y - double(b.x) * a.y;
+		}
+		if (area < 0) {
+			reverse(v.begin(), v.end());
+		}
+		rotate(v.begin(), min_element(v.begin(), v.end(), isLeftOf), v.end());
+		rightmost = max_element(v.begin(), v.end(), isLeftOf) - v.begin();
+	}
+
+	// The vertices, in ccw order from the leftmost.
+	const vector<point>& vertices() const { return v; }
+
+	size_t size() const { return v.size(); }
+
+	bool empty() const { return v.empty(); }
+
+	const point& operator[](size_t i) const { return v[i]; }
+
+	// Whether p is in or on the polygon.
+	bool contains(const point& p) const {
+		if (v.size() < 3) {
+			return v.size() == 1 ? v[0].x == p.x && v[0].y == p.y :
+				v.size() == 2 && onSegment(v[0], v[1], p);
+		}
+		return containsFan(v.data(), v.size(), p);
+	}
+
+	// Sets inside[i] to contains((x[i], y[i])) for each of n points,
+	// several at a time where there's SIMD.
+	void contains(const float* x, const float* y, size_t n, uint8_t* inside) const {
+		if (v.size() < 3) {
+			for (size_t i = 0; i < n; ++i) {
+				inside[i] = contains(point(x[i], y[i]));
+			}
+			return;
+		}
+		containsKernel()(v.data(), v.size(), x, y, n, inside);
+	}
+
+	void contains(const PointSoA& q, uint8_t* inside) const {
+		contains(q.x.data(), q.y.data(), q.size(), inside);
+	}
+
+	// The index of the vertex farthest in direction d, the first in
+	// ccw order on ties. The polygon must not be empty.
+	size_t extreme(const point& d) const {
+		if (v.size() < 3) {
+			return v.size() == 2 && dot(d, v[1]) > dot(d, v[0]) ? 1 : 0;
+		}
+		const size_t lower = extremeOnChain(0, rightmost, d);
+		const size_t upper = extremeOnChain(rightmost, v.size(), d);
+		return dot(d, v[upper]) > dot(d, v[lower]) ? upper : lower;
+	}
+
+	// Finds the vertices where the two tangents from p touch the
+	// polygon: every vertex is on or right of (p, v[left]), and on or
+	// left of (p, v[right]). Returns false if p is inside.
+	bool tangents(const point& p, size_t& left, size_t& right) const {
+		if (contains(p)) {
+			return false;
+		}
+		const size_t n = v.size();
+		if (n < 3) {
+			left = right = 0;
+			for (size_t i = 1; i < n; ++i) {
+				if (ccw(p, v[left], v[i]) > 0) {
+					left = i;
+				}
+				if (ccw(p, v[right], v[i]) < 0) {
+					right = i;
+				}
+			}
+			return true;
+		}
+
+		// The edges p sees, those it's strictly right of, are a run
+		// [first, last) in ccw order. On each chain they're a prefix
+		// or a suffix of the edges to one side of p, so binary search
+		// finds the ends of the run.
+		size_t first;
+		size_t last;
+		if (isLeftOf(p, v[0])) {
+			// Past the left end: the end of the upper chain and the
+			// start of the lower chain.
+			first = firstVisible(rightmost, n, p);
+			last = firstHidden(0, rightmost, p);
+		} else if (isLeftOf(v[rightmost], p)) {
+			first = firstVisible(0, rightmost, p);
+			last = firstHidden(rightmost, n, p);
+		} else {
+			// Above or below the chains, p sees the edge that spans
+			// it and some of those to either side.
+			const size_t below = partition_point(v.begin() + 1, v.begin() + rightmost,
+				[&](const point& q) { return !isLeftOf(p, q); }) - v.begin() - 1;
+			const size_t above = partition_point(v.begin() + rightmost + 1, v.end(),
+				[&](const point& q) { return isLeftOf(p, q); }) - v.begin() - 1;
+			if (visible(below, p)) {
+				first = firstVisible(0, below, p);
+				last = firstHidden(below + 1, rightmost, p);
+			} else {
+				first = firstVisible(rightmost, above, p);
+				last = firstHidden(above + 1, n, p);
+			}
+		}
+		left = first % n;
+		right = last % n;
+		return true;
+	}
+
+	// Whether the line through a and b crosses or touches the polygon.
+	bool hitsLine(const point& a, const point& b) const {
+		if (a.x == b.x && a.y == b.y) {
+			return contains(a);
+		}
+		if (v.empty()) {
+			return false;
+		}
+		const point normal(a.y - b.y, b.x - a.x);
+		return ccw(a, b, v[extreme(normal)]) >= 0 &&
+			ccw(a, b, v[extreme(point(-normal.x, -normal.y))]) <= 0;
+	}
+
+	// Whether segment (a, b) crosses or touches the polygon. The line
+	// through a and b enters the polygon on one chain between its
+	// extreme vertices across the line and leaves on the other, so
+	// binary search finds where, and the segment hits if it overlaps
+	// that stretch.
+	bool hitsSegment(const point& a, const point& b) const {
+		if (!hitsLine(a, b)) {
+			return false;
+		}
+		if (contains(a) || contains(b)) {
+			return true;
+		}
+		const size_t n = v.size();
+		if (n < 3) {
+			if (onSegment(a, b, v[0]) || (n == 2 && onSegment(a, b, v[1]))) {
+				return true;
+			}
+			// The line crosses segment (v[0], v[1]), so the segments
+			// cross if a and b are on either side of it.
+			const float ca = n == 2 ? ccw(v[0], v[1], a) : 0;
+			const float cb = n == 2 ? ccw(v[0], v[1], b) : 0;
+			return (ca < 0 && cb > 0) || (ca > 0 && cb < 0);
+		}
+
+		const point normal(a.y - b.y, b.x - a.x);
+		const size_t top = extreme(normal);
+		const size_t bottom = extreme(point(-normal.x, -normal.y));
+		const double t1 = crossing(a, b, top, bottom, -1);
+		const double t2 = crossing(a, b, bottom, top, 1);
+		return min(t1, t2) <= 1 && max(t1, t2) >= 0;
+	}
+
+private:
+	static float dot(const point& d, const point& p) {
+		return d.x * p.x + d.y * p.y;
+	}
+
+	// Vertex i, where vertex n is vertex 0.
+	const point& at(size_t i) const {
+		return v[i == v.size() ? 0 : i];
+	}
+
+	// Whether p is strictly right of edge i, which runs from vertex i
+	// to vertex i + 1.
+	bool visible(size_t i, const point& p) const {
+		return ccw(at(i), at(i + 1), p) < 0;
+	}
+
+	// The vertex farthest in direction d among vertices [first, last]
+	// of a chain. Along a chain, the edge directions turn through at
+	// most half a circle, so the vertices first rise and then fall in
+	// direction d, or first fall and then rise.
+	size_t extremeOnChain(size_t first, size_t last, const point& d) const {
+		auto rises = [&](size_t i) {
+			return d.x * (at(i + 1).x - at(i).x) + d.y * (at(i + 1).y - at(i).y) > 0;
+		};
+		if (first == last) {
+			return first % v.size();
+		}
+		if (!rises(first)) {
+			return (dot(d, at(last)) > dot(d, at(first)) ? last : first) % v.size();
+		}
+		size_t lo = first + 1;
+		size_t hi = last;
+		while (lo < hi) {
+			const size_t mid = (lo + hi) / 2;
+			if (rises(mid)) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		return lo % v.size();
+	}
+
+	// The first of edges [first, last) that p sees, or last, where
+	// the edges p sees are a suffix.
+	size_t firstVisible(size_t first, size_t last, const point& p) const {
+		while (first < last) {
+			const size_t mid = (first + last) / 2;
+			if (visible(mid, p)) {
+				last = mid;
+			} else {
+				first = mid + 1;
+			}
+		}
+		return first;
+	}
+
+	// The first of edges [first, last) that p doesn't see, or last,
+	// where the edges p sees are a prefix.
+	size_t firstHidden(size_t first, size_t last, const point& p) const {
+		while (first < last) {
+			const size_t mid = (first + last) / 2;
+			if (visible(mid, p)) {
+				first = mid + 1;
+			} else {
+				last = mid;
+			}
+		}
+		return first;
+	}
+
+	// Where the line through a and b crosses the boundary between
+	// vertices from and to, going ccw, as a multiple t of (b - a) from
+	// a. ccw(a, b, vertex) goes down along that stretch if sign is -1
+	// and up if it's 1.
+	double crossing(const point& a, const point& b, size_t from, size_t to, int sign) const {
+		const size_t n = v.size();
+		auto c = [&](size_t o) { return ccw(a, b, v[(from + o) % n]); };
+		// The first vertex past the line, at an offset in [1, count].
+		const size_t count = (to + n - from) % n;
+		size_t lo = 1;
+		size_t hi = count + 1;
+		while (lo < hi) {
+			const size_t mid = (lo + hi) / 2;
+			if (sign < 0 ? c(mid) < 0 : c(mid) >= 0) {
+				hi = mid;
+			} else {
+				lo = mid + 1;
+			}
+		}
+
+		const double dx = double(b.x) - a.x;
+		const double dy = double(b.y) - a.y;
+		auto along = [&](const point& q) {
+			return ((q.x - a.x) * dx + (q.y - a.y) * dy) / (dx * dx + dy * dy);
+		};
+		if (lo > count) {
+			return along(v[to]);
+		}
+		const point& u = v[(from + lo - 1) % n];
+		const point& w = v[(from + lo) % n];
+		const double cu = c(lo - 1);
+		const double cw = c(lo);
+		const double s = cu == cw ? 0 : cu / (cu - cw);
+		return along(u) + s * (along(w) - along(u));
+	}
+
+	vector<point> v;
+	// The rightmost vertex, where the lower chain ends.
+	size_t rightmost;
+};
+
+// The number of envelope vertices CoherentHull tests points against
+// before testing them against the whole envelope.
+const size_t coherentCoreSize = 16;
+
+// Keeps the hull of a point set that moves a little from one frame to
+// the next, such as a set of tracked points. Each update takes the
+// same points in the same order as the last, at their new positions.
+// The hull of the last hull's vertices at their new positions is an
+// envelope that every point strictly inside can't be on the new hull,
+// so only the points outside it, and the old vertices, are wrapped
+// again. That costs O(n log h) for the containment tests, with AVX2
+// where it's available, and O(k log k) for the k points reprocessed.
+// When more than a fraction maxChanged of the points are outside, or
+// the point count changes, the hull is recomputed with quickHull.
+// Gives the hull in the order monotoneChain does.
+class CoherentHull {
+public:
+	explicit CoherentHull(float maxChanged = 0.25f)
+		: maxChanged(maxChanged), frameSize(0), full(false), changed(0) { }
+
+	// The hull of v, which are the last update's points, moved.
+	const vector<point>& update(const PointSoA& v) {
+		const size_t n = v.size();
+		if (n != frameSize || indices.size() < 3) {
+			return recompute(v);
+		}
+
+		// Wrap the old vertices at their new positions.
+		points.clear();
+		for (size_t i : indices) {
+			points.push_back(v[i]);
+		}
+		envelope.assign(monotoneChain(points.data(), points.size(), ws));
+		if (envelope.size() < 3) {
+			return recompute(v);
+		}
+
+		// Most points are inside a polygon of a few of the envelope's
+		// vertices, which the containment kernel tests in fewer steps.
+		// The rest get the full test.
+		inside.resize(n);
+		const vector<point>& e = envelope.vertices();
+		if (e.size() > 2 * coherentCoreSize) {
+			points.clear();
+			for (size_t k = 0; k < coherentCoreSize; ++k) {
+				points.push_back(e[k * e.size() / coherentCoreSize]);
+			}
+			core.assign(points);
+			core.contains(v, inside.data());
+			for (size_t i = 0; i < n; ++i) {
+				if (!inside[i]) {
+					inside[i] = envelope.contains(v[i]);
+				}
+			}
+		} else {
+			envelope.contains(v, inside.data());
+		}
+		for (size_t i : indices) {
+			inside[i] = 0;
+		}
+		candidates.clear();
+		for (size_t i = 0; i < n; ++i) {
+			if (!inside[i]) {
+				candidates.push_back(i);
+			}
+		}
+		changed = candidates.size() - indices.size();
+		if (changed > maxChanged * n) {
+			return recompute(v);
+		}
+		full = false;
+		return wrapCandidates(v);
+	}
+
+	// As above, for a vector of points.
+	const vector<point>& update(const vector<point>& v) {
+		soa.clear();
+		for (const point& p : v) {
+			soa.push_back(p);
+		}
+		return update(soa);
+	}
+
+	// Forgets the last frame, so the next update recomputes.
+	void reset() {
+		frameSize = 0;
+		indices.clear();
+		h.clear();
+	}
+
+	// The hull from the last update.
+	const vector<point>& hull() const { return h; }
+
+	// The index among the last update's points of each hull vertex.
+	const vector<size_t>& hullIndices() const { return indices; }
+
+	// Whether the last update recomputed the hull from scratch.
+	bool recomputed() const { return full; }
+
+	// The number of points outside the envelope in the last update,
+	// not counting the old vertices.
+	size_t changedPoints() const { return changed; }
+
+private:
+	// Finds the hull of all of v with quickHull, and then the index of
+	// each of its vertices.
+	const vector<point>& recompute(const PointSoA& v) {
+		HULL_TRACE("CoherentHull::recompute");
+		const size_t n = v.size();
+		frameSize = n;
+		full = true;
+		changed = n;
+		candidates.clear();
+		if (n < 3) {
+			for (size_t i = 0; i < n; ++i) {
+				candidates.push_back(i);
+			}
+			return wrapCandidates(v);
+		}
+
+		points = quickHull(v, ws);
+		sort(points.begin(), points.end(), isLeftOf);
+		found.assign(points.size(), n);
+		for (size_t i = 0; i < n; ++i) {
+			const point p = v[i];
+			auto it = lower_bound(points.begin(), points.end(), p, isLeftOf);
+			if (it != points.end() && it->x == p.x && it->y == p.y && found[it - points.begin()] == n) {
+				found[it - points.begin()] = i;
+			}
+		}
+		for (size_t i : found) {
+			if (i < n) {
+				candidates.push_back(i);
+			}
+		}
+		return wrapCandidates(v);
+	}
+
+	// Sets the hull to the hull of the candidates, and the indices to
+	// those of its vertices.
+	const vector<point>& wrapCandidates(const PointSoA& v) {
+		sort(candidates.begin(), candidates.end(), [&](size_t a, size_t b) {
+			return isLeftOf(v[a], v[b]);
+		});
+		points.clear();
+		for (size_t i : candidates) {
+			points.push_back(v[i]);
+		}
+		if (points.size() < 3) {
+			h = points;
+			indices = candidates;
+			return h;
+		}
+
+		// The points are sorted, so monotoneChain skips its sort, and
+		// each vertex can be found among them by binary search.
+		h = monotoneChain(points.data(), points.size(), ws);
+		indices.clear();
+		for (const point& p : h) {
+			indices.push_back(candidates[lower_bound(points.begin(), points.end(), p, isLeftOf) - points.begin()]);
+		}
+		return h;
+	}
+
+	float maxChanged;
+	size_t frameSize;
+	bool full;
+	size_t changed;
+	vector<point> h;
+	vector<size_t> indices;
+	// Buffers reused from one update to the next.
+	HullIndex envelope;
+	HullIndex core;
+	HullWorkspace ws;
+	PointSoA soa;
+	vector<point> points;
+	vector<size_t> candidates;
+	vector<size_t> found;
+	vector<uint8_t> inside;
+};
+
+// A rectangle at any angle, with its corners in ccw order.
+struct OrientedRectangle {
+	point corners[4];
+	float area;
+	float perimeter;
+};
+
+// Measures of a convex polygon, as found by measureHull.
+struct HullMeasures {
+	// The two vertices farthest apart, and their distance.
+	point diameterFrom;
+	point diameterTo;
+	float diameter;
+	// The least distance between two parallel lines that enclose it.
+	float width;
+	// The enclosing rectangles of least area and least perimeter.
+	OrientedRectangle minAreaRectangle;
+	OrientedRectangle minPerimeterRectangle;
+};
+
+// Measures the convex polygon h[0, n), such as the output of any of
+// the algorithms, in either order, in O(n) with rotating calipers.
+// Some side of each least enclosing rectangle lies along an edge, so
+// for each edge we find the vertices farthest along it, against it
+// and away from it. Going round the edges in ccw order, those vertices
+// only ever move forward, so each goes round the polygon once. The
+// vertices the farthest one passes over on the way to an edge's are
+// antipodal to its ends, and the diameter is between some such pair.
+// Uses ws.points, so it doesn't allocate once ws has grown to fit.
+HullMeasures measureHull(const point* h, size_t n, HullWorkspace& ws) {
+	HULL_TRACE("measureHull");
+	HullMeasures m = HullMeasures();
+	if (n < 3) {
+		const point a = n ? h[0] : point();
+		const point b = n ? h[n - 1] : point();
+		m.diameterFrom = a;
+		m.diameterTo = b;
+		m.diameter = len(a, b);
+		OrientedRectangle r = { { a, b, b, a }, 0, 2 * m.diameter };
+		m.minAreaRectangle = m.minPerimeterRectangle = r;
+		return m;
+	}
+
+	// Work on a ccw copy.
+	vector<point>& p = ws.points;
+	p.assign(h, h + n);
+	double area = 0;
+	for (size_t i = 0; i < n; ++i) {
+		area += double(p[i].x) * p[(i + 1) % n].y - double(p[(i + 1) % n].x) * p[i].y;
+	}
+	if (area < 0) {
+		reverse(p.begin(), p.end());
+	}
+
+	auto next = [n](size_t i) { return i + 1 == n ? 0 : i + 1; };
+	// Coordinates of p[i] along the unit vector (ux, uy).
+	auto along = [&](size_t i, double ux, double uy) {
+		return ux * p[i].x + uy * p[i].y;
+	};
+
+	double bestArea = INFINITY;
+	double bestPerimeter = INFINITY;
+	double bestWidth = INFINITY;
+	double bestDiameter = -1;
+	size_t right = 0;
+	size_t top = 0;
+	size_t left = 0;
+	bool started = false;
+	size_t firstEdge = 0;
+	// The pair farthest apart so far. A vertex is antipodal to every
+	// vertex top passes over while the edges either side of it are
+	// measured, so the pairs tried are each end of the edge with every
+	// one of those, and with a vertex tied with top on an edge parallel
+	// to this one.
+	auto tryPair = [&](size_t a, size_t b) {
+		const double dx = double(p[b].x) - p[a].x;
+		const double dy = double(p[b].y) - p[a].y;
+		if (dx * dx + dy * dy > bestDiameter) {
+			bestDiameter = dx * dx + dy * dy;
+			m.diameterFrom = p[a];
+			m.diameterTo = p[b];
+		}
+	};
+	// The first edge is measured again at the end, when top comes round
+	// to it from the last edge's top rather than from its own end, to
+	// try the pairs it skipped the first time.
+	for (size_t step = 0; step < 2 * n; ++step) {
+		const size_t i = step % n;
+		if (started && step >= n && i > firstEdge) {
+			break;
+		}
+		const size_t j = next(i);
+		double ux = double(p[j].x) - p[i].x;
+		double uy = double(p[j].y) - p[i].y;
+		const double length = sqrt(ux * ux + uy * uy);
+		if (length == 0) {
+			continue;
+		}
+		ux /= length;
+		uy /= length;
+		// The normal (nx, ny) points into the polygon.
+		const double nx = -uy;
+		const double ny = ux;
+
+		// The first edge starts the calipers off from its own end,
+		// each from where the one before it stopped.
+		if (!started) {
+			right = j;
+		}
+		while (along(next(right), ux, uy) > along(right, ux, uy)) {
+			right = next(right);
+		}
+		if (!started) {
+			top = right;
+		}
+		tryPair(i, top);
+		tryPair(j, top);
+		while (along(next(top), nx, ny) > along(top, nx, ny)) {
+			top = next(top);
+			tryPair(i, top);
+			tryPair(j, top);
+		}
+		if (along(next(top), nx, ny) == along(top, nx, ny)) {
+			tryPair(i, next(top));
+			tryPair(j, next(top));
+		}
+		if (!started) {
+			left = top;
+			firstEdge = i;
+			started = true;
+		}
+		while (along(next(left), ux, uy) < along(left, ux, uy)) {
+			left = next(left);
+		}
+
+		const double base = along(i, nx, ny);
+		const double height = along(top, nx, ny) - base;
+		const double lo = along(left, ux, uy);
+		const double hi = along(right, ux, uy);
+		const double w = hi - lo;
+		bestWidth = min(bestWidth, height);
+
+		auto corner = [&](double a, double b) {
+			return point(float(ux * a + nx * b), float(uy * a + ny * b));
+		};
+		const OrientedRectangle r = {
+			{ corner(lo, base), corner(hi, base), corner(hi, base + height), corner(lo, base + height) },
+			float(w * height), float(2 * (w + height))
+		};
+		if (w * height < bestArea) {
+			bestArea = w * height;
+			m.minAreaRectangle = r;
+		}
+		if (w + height < bestPerimeter) {
+			bestPerimeter = w + height;
+			m.minPerimeterRectangle = r;
+		}
+	}
+
+	m.diameter = float(sqrt(max(bestDiameter, 0.0)));
+	m.width = float(bestWidth);
+	return m;
+}
+
+HullMeasures measureHull(const vector<point>& h) {
+	HullWorkspace ws;
+	return measureHull(h.data(), h.size(), ws);
+}
+
+// Measures many hulls in one call, such as those from batchHulls.
+// Hull i is hulls[hullOffsets[i], hullOffsets[i + 1]), and its
+// measures are left in measures[i]. Threads take hulls a block at a
+// time, each with its own workspace.
+void measureHulls(const vector<point>& hulls, const vector<size_t>& hullOffsets,
+	vector<HullMeasures>& measures, unsigned threadCount = thread::hardware_concurrency()) {
+	HULL_TRACE("measureHulls");
+	const size_t count = hullOffsets.empty() ? 0 : hullOffsets.size() - 1;
+	measures.resize(count);
+
+	atomic<size_t> nextHull(0);
+	auto work = [&] {
+		HullWorkspace ws;
+		for (size_t first; (first = nextHull.fetch_add(setsPerTask)) < count; ) {
+			for (size_t i = first; i < min(first + setsPerTask, count); ++i) {
+				measures[i] = measureHull(hulls.data() + hullOffsets[i],
+					hullOffsets[i + 1] - hullOffsets[i], ws);
+			}
+		}
+	};
+	const size_t threads = min<size_t>(max(threadCount, 1u), (count + setsPerTask - 1) / setsPerTask);
+	vector<thread> pool;
+	for (size_t t = 1; t < threads; ++t) {
+		pool.emplace_back(work);
+	}
+	work();
+	for (auto& t : pool) {
+		t.join();
+	}
+}
+
+// Puts the vertices of the convex polygon h[0, n), in either order,
+// in out, sorted by isLeftOf, in O(n). Both ways round the polygon
+// from its leftmost vertex to its rightmost are already sorted, so
+// sorting is a merge of the two, which are put in runs first.
+void sortVertices(const point* h, size_t n, vector<point>& runs, vector<point>& out) {
+	runs.clear();
+	out.clear();
+	if (n == 0) {
+		return;
+	}
+	const size_t l = min_element(h, h + n, isLeftOf) - h;
+	const size_t r = max_element(h, h + n, isLeftOf) - h;
+	for (size_t i = l; ; i = (i + 1) % n) {
+		runs.push_back(h[i]);
+		if (i == r) {
+			break;
+		}
+	}
+	const size_t mid = runs.size();
+	for (size_t i = (l + n - 1) % n; i != r; i = (i + n - 1) % n) {
+		runs.push_back(h[i]);
+	}
+	out.resize(runs.size());
+	merge(runs.begin(), runs.begin() + mid, runs.begin() + mid, runs.end(), out.begin(), isLeftOf);
+}
+
+// The hull of two convex polygons, in the same order as monotoneChain,
+// in O(h) for h vertices between them. The polygons can overlap, for
+// example hulls of shards of the same point cloud, so instead of
+// searching for bridges between them, their sorted vertices are
+// merged and passed through the scan of monotoneChain, which skips
+// its sort for sorted points. Uses the buffers in ws, and returns
+// ws.hull. The sorted vertices of a and b are kept in buffers the
+// scan only clears later, so once ws has grown no merge allocates.
+const vector<point>& mergeHulls(const point* a, size_t na, const point* b, size_t nb, HullWorkspace& ws) {
+	HULL_TRACE("mergeHulls");
+	sortVertices(a, na, ws.lower, ws.upper);
+	sortVertices(b, nb, ws.lower, ws.hull);
+	vector<point>& merged = ws.merged;
+	merged.resize(ws.upper.size() + ws.hull.size());
+	merge(ws.upper.begin(), ws.upper.end(), ws.hull.begin(), ws.hull.end(), merged.begin(), isLeftOf);
+	if (merged.size() < 3) {
+		ws.hull.assign(merged.begin(), merged.end());
+		return ws.hull;
+	}
+	return monotoneChain(merged.data(), merged.size(), ws);
+}
+
+vector<point> mergeHulls(const vector<point>& a, const vector<point>& b) {
+	HullWorkspace ws;
+	mergeHulls(a.data(), a.size(), b.data(), b.size(), ws);
+	return move(ws.hull);
+}
+
+// Merges many hulls into one, such as the hulls of the shards of a
+// point cloud. Hull i is hulls[hullOffsets[i], hullOffsets[i + 1]).
+// Each round merges pairs of hulls on threadCount threads, so k hulls
+// take ceil(log2(k)) rounds. A single hull is returned as it is.
+vector<point> reduceHulls(const vector<point>& hulls, const vector<size_t>& hullOffsets,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	HULL_TRACE("reduceHulls");
+	const size_t count = hullOffsets.empty() ? 0 : hullOffsets.size() - 1;
+	vector<vector<point>> level;
+	for (size_t i = 0; i < count; ++i) {
+		level.push_back(toPoints(hulls, hullOffsets[i], hullOffsets[i + 1]));
+	}
+	if (level.empty()) {
+		return vector<point>();
+	}
+
+	while (level.size() > 1) {
+		vector<vector<point>> next((level.size() + 1) / 2);
+		parallelFor(next.size(), threadCount, [&](size_t i) {
+			next[i] = 2 * i + 1 < level.size() ? mergeHulls(level[2 * i], level[2 * i + 1]) : move(level[2 * i]);
+		});
+		level.swap(next);
+	}
+	return move(level[0]);
+}
+
+// The point distributions the generators draw from.
+enum Distribution {
+	UniformSquare,
+	UniformDisk,
+	OnCircle,
+	Gaussian,
+	Clustered,
+	Collinear,
+	Duplicates,
+	distributionCount
+};
+
+const char* distributionName(Distribution d) {
+	static const char* names[] = {
+		"uniform-square", "uniform-disk", "on-circle", "gaussian", "clustered",
+		"collinear", "duplicates"
+	};
+	return names[d];
+}
+
+// The splitmix64 finalizer, which scrambles x into 64 random-looking
+// bits.
+uint64_t mixBits(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ull;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebull;
+	return x ^ (x >> 31);
+}
+
+// Random bits for draw k of point i of the stream for seed. They
+// depend on nothing else, so any range of points can be generated on
+// its own, on any thread, and comes out the same.
+uint64_t randomBits(uint64_t seed, uint64_t i, uint64_t k) {
+	return mixBits(mixBits(seed) + 4 * i + k);
+}
+
+// The top 24 bits as a float in [-1, 1), exactly.
+float signedUnit(uint64_t bits) {
+	return float(int32_t(bits >> 40) - (1 << 23)) * (1.0f / (1 << 23));
+}
+
+// The top 24 bits as a float in (0, 1], exactly.
+float positiveUnit(uint64_t bits) {
+	return float((bits >> 40) + 1) * (1.0f / (1 << 24));
+}
+
+// The centers of the Clustered distribution's clusters, and the
+// distinct points of the Duplicates distribution.
+const size_t generatorClusters = 16;
+const size_t generatorDistinctPoints = 64;
+
+// Point i of distribution d for seed. All points are within
+// [-100, 100] on both axes, apart from the Gaussian's rare outliers.
+// On the circle every point is on the hull. Collinear points are on
+// the integer grid, on the edges and diagonals of the square, so many
+// are exactly collinear. Duplicates repeat 64 distinct points.
+point generatePoint(Distribution d, uint64_t seed, uint64_t i) {
+	const float twoPi = 6.2831853f;
+	const uint64_t a = randomBits(seed, i, 0);
+	const uint64_t b = randomBits(seed, i, 1);
+	switch (d) {
+	case UniformSquare:
+		return point(100 * signedUnit(a), 100 * signedUnit(b));
+	case UniformDisk: {
+		// The sqrt keeps points from bunching at the center.
+		const float r = 100 * sqrt(positiveUnit(a));
+		const float t = twoPi * positiveUnit(b);
+		return point(r * cos(t), r * sin(t));
+	}
+	case OnCircle: {
+		const float t = twoPi * positiveUnit(b);
+		return point(100 * cos(t), 100 * sin(t));
+	}
+	case Gaussian: {
+		// Box-Muller.
+		const float r = 30 * sqrt(-2 * log(positiveUnit(a)));
+		const float t = twoPi * positiveUnit(b);
+		return point(r * cos(t), r * sin(t));
+	}
+	case Clustered: {
+		// The centers are drawn from the stream past every point.
+		const uint64_t c = ~uint64_t(0) - a % generatorClusters;
+		const point center(90 * signedUnit(randomBits(seed, c, 0)),
+			90 * signedUnit(randomBits(seed, c, 1)));
+		const float r = 3 * sqrt(-2 * log(positiveUnit(b)));
+		const float t = twoPi * positiveUnit(randomBits(seed, i, 2));
+		return point(center.x + r * cos(t), center.y + r * sin(t));
+	}
+	case Collinear: {
+		const float t = float(int64_t(b % 201) - 100);
+		switch (a % 6) {
+		case 0: return point(t, -100);
+		case 1: return point(100, t);
+		case 2: return point(t, 100);
+		case 3: return point(-100, t);
+		case 4: return point(t, t);
+		default: return point(t, -t);
+		}
+	}
+	default: {
+		const uint64_t j = ~uint64_t(0) - a % generatorDistinctPoints;
+		return point(100 * signedUnit(randomBits(seed, j, 0)), 100 * signedUnit(randomBits(seed, j, 1)));
+	}
+	}
+}
+
+// Points generated by a thread at a time.
+const size_t generatorBlockSize = 1 << 16;
+
+// Calls out(j, p) with point first + j of distribution d for seed,
+// for each j in [0, count), on up to threadCount threads. Every point
+// is computed from its index alone, so the points don't depend on the
+// thread count or on how a large set is split into calls.
+template <typename Output>
+void generatePoints(Distribution d, uint64_t seed, size_t first, size_t count,
+	unsigned threadCount, Output out) {
+	HULL_TRACE("generatePoints");
+	const size_t blocks = (count + generatorBlockSize - 1) / generatorBlockSize;
+	parallelFor(blocks, threadCount, [&](size_t block) {
+		const size_t lo = block * generatorBlockSize;
+		const size_t hi = min(lo + generatorBlockSize, count);
+		for (size_t j = lo; j < hi; ++j) {
+			out(j, generatePoint(d, seed, first + j));
+		}
+	});
+}
+
+// As above, into out[0, count), which may be a mapped file.
+void generatePoints(Distribution d, uint64_t seed, size_t first, size_t count, point* out,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	generatePoints(d, seed, first, count, threadCount, [out](size_t j, const point& p) {
+		out[j] = p;
+	});
+}
+
+// As above, into the arrays x[0, count) and y[0, count).
+void generatePoints(Distribution d, uint64_t seed, size_t first, size_t count, float* x, float* y,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	generatePoints(d, seed, first, count, threadCount, [x, y](size_t j, const point& p) {
+		x[j] = p.x;
+		y[j] = p.y;
+	});
+}
+
+// Returns count points from distribution d, the same ones for the same
+// seed.
+vector<point> generatePoints(Distribution d, size_t count, uint64_t seed,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	vector<point> v(count);
+	generatePoints(d, seed, 0, count, v.data(), threadCount);
+	return v;
+}
+
+PointSoA generatePointSoA(Distribution d, size_t count, uint64_t seed,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	PointSoA v(count);
+	generatePoints(d, seed, 0, count, v.x.data(), v.y.data(), threadCount);
+	return v;
+}
+
+// A point file is either flat float32 x, y pairs, or a PointFileHeader
+// followed by them. Both are in the machine's byte order.
+const char pointFileMagic[8] = { 'C', 'H', 'P', 'O', 'I', 'N', 'T', 'S' };
+
+struct PointFileHeader {
+	char magic[8];
+	uint64_t count;
+};
+
+// Writes v to path with a header.
+void writePointFile(const string& path, const vector<point>& v) {
+	PointFileHeader header;
+	memcpy(header.magic, pointFileMagic, sizeof(header.magic));
+	header.count = v.size();
+	ofstream out(path, ios::binary);
+	out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.write(reinterpret_cast<const char*>(v.data()), v.size() * sizeof(point));
+	if (!out) {
+		throw runtime_error("can't write " + path);
+	}
+}
+
+#ifdef CONVEXHULL_POSIX
+// A point file mapped read-only into memory. Pages are only read in
+// as they're touched, so mapping even a huge file is cheap.
+class PointFile {
+public:
+	explicit PointFile(const string& path) : map(nullptr), mapSize(0), points(nullptr), count(0) {
+		const int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw runtime_error("can't open " + path + ": " + strerror(errno));
+		}
+		struct stat st;
+		if (fstat(fd, &st) != 0) {
+			const int error = errno;
+			close(fd);
+			throw runtime_error("can't stat " + path + ": " + strerror(error));
+		}
+		mapSize = size_t(st.st_size);
+		if (mapSize > 0) {
+			map = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		}
+		// Keep mmap's error before the calls below can change errno.
+		const int error = errno;
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+		// The mapping keeps the file open.
+		close(fd);
+		if (map == MAP_FAILED) {
+			map = nullptr;
+			throw runtime_error("can't map " + path + ": " + strerror(error));
+		}
+
+		const char* bytes = static_cast<const char*>(map);
+		size_t offset = 0;
+		count = mapSize / sizeof(point);
+		if (mapSize >= sizeof(PointFileHeader) && memcmp(bytes, pointFileMagic, sizeof(pointFileMagic)) == 0) {
+			PointFileHeader header;
+			memcpy(&header, bytes, sizeof(header));
+			offset = sizeof(header);
+			count = (mapSize - offset) / sizeof(point);
+			if (header.count > count) {
+				unmap();
+				throw runtime_error(path + " is truncated");
+			}
+			count = size_t(header.count);
+		}
+		points = reinterpret_cast<const point*>(bytes + offset);
+		madvise(map, mapSize, MADV_SEQUENTIAL);
+	}
+
+	~PointFile() {
+		unmap();
+	}
+
+	PointFile(const PointFile&) = delete;
+	PointFile& operator=(const PointFile&) = delete;
+
+	const point* data() const {
+		return points;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	// Asks for points [first, first + n) to be read in ahead of use.
+	void willNeed(size_t first, size_t n) const {
+		advise(first, n, MADV_WILLNEED);
+	}
+
+	// Lets points [first, first + n) go, so the pages already scanned
+	// don't stay resident. They're read in again if touched.
+	void doneWith(size_t first, size_t n) const {
+		advise(first, n, MADV_DONTNEED);
+	}
+
+private:
+	void advise(size_t first, size_t n, int advice) const {
+		// madvise wants whole pages, so shrink the range to the pages
+		// within it.
+		const uintptr_t page = uintptr_t(sysconf(_SC_PAGESIZE));
+		uintptr_t begin = reinterpret_cast<uintptr_t>(points + first);
+		uintptr_t end = reinterpret_cast<uintptr_t>(points + min(first + n, count));
+		if (advice == MADV_WILLNEED) {
+			begin = begin / page * page;
+		} else {
+			begin = (begin + page - 1) / page * page;
+		}
+		end = end / page * page;
+		if (begin < end) {
+			madvise(reinterpret_cast<void*>(begin), end - begin, advice);
+		}
+	}
+
+	void unmap() {
+		if (map) {
+			munmap(map, mapSize);
+			map = nullptr;
+		}
+	}
+
+	void* map;
+	size_t mapSize;
+	const point* points;
+	size_t count;
+};
+
+// Writes count points from distribution d for seed to a point file at
+// path with a header. They're generated straight into a shared
+// mapping of the file, so sets larger than memory can be written.
+void generatePointFile(const string& path, Distribution d, size_t count, uint64_t seed,
+	unsigned threadCount = thread::hardware_concurrency()) {
+	const int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0) {
+		throw runtime_error("can't create " + path + ": " + strerror(errno));
+	}
+	const size_t size = sizeof(PointFileHeader) + count * sizeof(point);
+	if (ftruncate(fd, off_t(size)) != 0) {
+		const int error = errno;
+		close(fd);
+		throw runtime_error("can't size " + path + ": " + strerror(error));
+	}
+	void* map = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	const int error = errno;
+	close(fd);
+	if (map == MAP_FAILED) {
+		throw runtime_error("can't map " + path + ": " + strerror(error));
+	}
+
+	PointFileHeader header;
+	memcpy(header.magic, pointFileMagic, sizeof(header.magic));
+	header.count = count;
+	memcpy(map, &header, sizeof(header));
+	generatePoints(d, seed, 0, count, reinterpret_cast<point*>(static_cast<char*>(map) + sizeof(header)),
+		threadCount);
+	munmap(map, size);
+}
+#endif
+
+// Points folded into the hull at a time by streamingHull.
+const size_t streamChunkSize = 1 << 20;
+
+// Finds the hull of v[0, n) a chunk at a time, folding each chunk
+// into the hull of the ones before it, so it only needs room for the
+// hull and one chunk. next(first, count) is told before each chunk is
+// read, and done(first, count) after, which streamingHull(path) uses
+// for readahead. Returns the hull in the order algorithm gives.
+template <typename Next, typename Done>
+vector<point> streamingHull(const point* v, size_t n, size_t chunkSize,
+	HullFunction algorithm, Next next, Done done) {
+	HULL_TRACE("streamingHull");
+	chunkSize = max(chunkSize, size_t(1));
+	// The hull so far is buffer[0, h), and each chunk is copied in
+	// after it.
+	vector<point> buffer;
+	HullWorkspace ws;
+	size_t h = 0;
+	for (size_t first = 0; first < n; first += chunkSize) {
+		const size_t count = min(chunkSize, n - first);
+		next(first, count);
+		buffer.resize(h + count);
+		copy(v + first, v + first + count, buffer.begin() + h);
+		done(first, count);
+		h += count;
+		if (h >= 3) {
+			h = algorithm(buffer.data(), h, buffer.data(), ws);
+		}
+	}
+	buffer.resize(h);
+	return buffer;
+}
+
+vector<point> streamingHull(const vector<point>& v, size_t chunkSize = streamChunkSize,
+	HullFunction algorithm = quickHull) {
+	auto ignore = [](size_t, size_t) { };
+	return streamingHull(v.data(), v.size(), chunkSize, algorithm, ignore, ignore);
+}
+
+#ifdef CONVEXHULL_POSIX
+// Finds the hull of the points in the file at path without reading it
+// all into memory. Each chunk's successor is read ahead while it's
+// hulled, and its pages are dropped once it has been copied out.
+vector<point> streamingHull(const string& path, size_t chunkSize = streamChunkSize,
+	HullFunction algorithm = quickHull) {
+	PointFile file(path);
+	chunkSize = max(chunkSize, size_t(1));
+	return streamingHull(file.data(), file.size(), chunkSize, algorithm,
+		[&](size_t first, size_t count) { file.willNeed(first + count, chunkSize); },
+		[&](size_t first, size_t count) { file.doneWith(first, count); });
+}
+#endif
+
+// Hulls written in binary are a HullFileHeader, then hullCount + 1
+// uint64 offsets, hull i being points [offsets[i], offsets[i + 1]),
+// then the points as float32 x, y pairs, all in the machine's byte
+// order. The offsets are the hullOffsets batchHulls gives.
+const char hullFileMagic[8] = { 'C', 'H', 'H', 'U', 'L', 'L', 'S', 0 };
+
+struct HullFileHeader {
+	char magic[8];
+	uint64_t hullCount;
+};
+
+// Bytes a HullWriter on a file descriptor buffers between writes.
+const size_t writerBufferSize = 1 << 16;
+
+// Room for one number, and for one line of text for a point.
+const size_t maxNumberSize = 24;
+const size_t maxLineSize = 2 * maxNumberSize + 3;
+
+// Writes hulls as text or binary, a buffer at a time, either to a file
+// descriptor or into a caller's memory, without going through
+// iostream.
+class HullWriter {
+public:
+#ifdef CONVEXHULL_POSIX
+	// Writes to fd whenever the buffer fills, and on flush.
+	explicit HullWriter(int fd, int precision = 0)
+		: fd(fd), storage(writerBufferSize), begin(storage.data()), cur(begin),
+		end(begin + storage.size()), flushed(0), failed(false), precision(clampPrecision(precision)) { }
+#endif
+
+	// Writes into out[0, capacity). Anything past the end is dropped.
+	HullWriter(char* out, size_t capacity, int precision = 0)
+		: fd(-1), begin(out), cur(out), end(out + capacity), flushed(0), failed(false),
+		precision(clampPrecision(precision)) { }
+
+	~HullWriter() {
+		flush();
+	}
+
+	HullWriter(const HullWriter&) = delete;
+	HullWriter& operator=(const HullWriter&) = delete;
+
+	void write(const void* data, size_t n) {
+		const char* p = static_cast<const char*>(data);
+		while (n > 0 && !failed) {
+			if (cur == end && !drain()) {
+				failed = true;
+				return;
+			}
+			const size_t count = min(n, size_t(end - cur));
+			memcpy(cur, p, count);
+			cur += count;
+			p += count;
+			n -= count;
+		}
+	}
+
+	// Writes one "x, y" line per point, as print() does. Numbers are
+	// written in the shortest form that reads back as the same float,
+	// or to precision significant digits if it's given.
+	void writeText(const point* v, size_t n) {
+		for (size_t i = 0; i < n && !failed; ++i) {
+			if (size_t(end - cur) < maxLineSize) {
+				drain();
+			}
+			if (size_t(end - cur) >= maxLineSize) {
+				cur = formatLine(cur, v[i]);
+			} else {
+				char line[maxLineSize];
+				write(line, formatLine(line, v[i]) - line);
+			}
+		}
+	}
+
+	void writeText(const vector<point>& v) {
+		writeText(v.data(), v.size());
+	}
+
+	// Writes hulls[hullOffsets[i], hullOffsets[i + 1]) for each hull i,
+	// in the binary format above.
+	void writeBinary(const vector<point>& hulls, const vector<size_t>& hullOffsets) {
+		HullFileHeader header;
+		memcpy(header.magic, hullFileMagic, sizeof(header.magic));
+		header.hullCount = hullOffsets.empty() ? 0 : hullOffsets.size() - 1;
+		write(&header, sizeof(header));
+		for (size_t i = 0; i <= header.hullCount; ++i) {
+			const uint64_t offset = hullOffsets[i];
+			write(&offset, sizeof(offset));
+		}
+		if (header.hullCount > 0) {
+			write(hulls.data(), hullOffsets.back() * sizeof(point));
+		}
+	}
+
+	void writeBinary(const vector<point>& hull) {
+		writeBinary(hull, vector<size_t>{ 0, hull.size() });
+	}
+
+	// Writes out what's buffered, if there's a file descriptor.
+	void flush() {
+		drain();
+	}
+
+	// The bytes written so far.
+	size_t size() const {
+		return flushed + (cur - begin);
+	}
+
+	// False once any output has been dropped, because the caller's
+	// memory is full or a write failed.
+	bool ok() const {
+		return !failed;
+	}
+
+private:
+	static int clampPrecision(int precision) {
+		// Nine digits are enough for any float, and keep every number
+		// within maxNumberSize.
+		return min(max(precision, 0), 9);
+	}
+
+	char* formatNumber(char* p, float f) const {
+		if (precision > 0) {
+			return to_chars(p, p + maxNumberSize, f, chars_format::general, precision).ptr;
+		}
+		return to_chars(p, p + maxNumberSize, f).ptr;
+	}
+
+	char* formatLine(char* p, const point& q) const {
+		p = formatNumber(p, q.x);
+		*p++ = ',';
+		*p++ = ' ';
+		p = formatNumber(p, q.y);
+		*p++ = '\n';
+		return p;
+	}
+
+	// Empties the buffer into the file descriptor. Returns false if
+	// there's none to empty it into.
+	bool drain() {
+#ifdef CONVEXHULL_POSIX
+		if (fd < 0) {
+			return false;
+		}
+		for (const char* p = begin; p < cur && !failed; ) {
+			const ssize_t count = ::write(fd, p, cur - p);
+			if (count > 0) {
+				p += count;
+			} else if (count < 0 && errno != EINTR) {
+				failed = true;
+			}
+		}
+		flushed += cur - begin;
+		cur = begin;
+		return !failed;
+#else
+		return false;
+#endif
+	}
+
+	int fd;
+	vector<char> storage;
+	char* begin;
+	char* cur;
+	char* end;
+	size_t flushed;
+	bool failed;
+	int precision;
+};
+
+// Reads hulls in the binary format above from data[0, size) into
+// hulls and hullOffsets.
+void readHulls(const char* data, size_t size, vector<point>& hulls, vector<size_t>& hullOffsets) {
+	HullFileHeader header;
+	if (size < sizeof(header) || memcmp(data, hullFileMagic, sizeof(hullFileMagic)) != 0) {
+		throw runtime_error("not a hull file");
+	}
+	memcpy(&header, data, sizeof(header));
+	const size_t offsetsSize = (header.hullCount + 1) * sizeof(uint64_t);
+	if (header.hullCount >= size / sizeof(uint64_t) || size - sizeof(header) < offsetsSize) {
+		throw runtime_error("hull file is truncated");
+	}
+	hullOffsets.resize(header.hullCount + 1);
+	for (size_t i = 0; i <= header.hullCount; ++i) {
+		uint64_t offset;
+		memcpy(&offset, data + sizeof(header) + i * sizeof(offset), sizeof(offset));
+		hullOffsets[i] = size_t(offset);
+		if (i > 0 && hullOffsets[i] < hullOffsets[i - 1]) {
+			throw runtime_error("hull file has bad offsets");
+		}
+	}
+	const size_t pointCount = hullOffsets.back();
+	const size_t pointsOffset = sizeof(header) + offsetsSize;
+	if (pointCount > (size - pointsOffset) / sizeof(point)) {
+		throw runtime_error("hull file is truncated");
+	}
+	hulls.resize(pointCount);
+	if (pointCount > 0) {
+		memcpy(hulls.data(), data + pointsOffset, pointCount * sizeof(point));
+	}
+}
+
+// Serializes hulls in the binary format above, for example to send to
+// the node that merges them. Hull i is hulls[hullOffsets[i],
+// hullOffsets[i + 1]). readHulls reads them back.
+vector<char> serializeHulls(const vector<point>& hulls, const vector<size_t>& hullOffsets) {
+	if (hullOffsets.empty()) {
+		return serializeHulls(hulls, vector<size_t>{ 0 });
+	}
+	const size_t count = hullOffsets.size() - 1;
+	vector<char> out(sizeof(HullFileHeader) + (count + 1) * sizeof(uint64_t) + hullOffsets.back() * sizeof(point));
+	HullWriter writer(out.data(), out.size());
+	writer.writeBinary(hulls, hullOffsets);
+	return out;
+}
+
+vector<char> serializeHulls(const vector<point>& hull) {
+	return serializeHulls(hull, vector<size_t>{ 0, hull.size() });
+}
+
+// Requests of up to this many points are coalesced into batches.
+const size_t serviceBatchMaxN = 1024;
+
+// The most points a HullService worker coalesces into one batch.
+const size_t serviceBatchMaxPoints = 1 << 16;
+
+// The latencies a HullService keeps for its percentiles, the newest.
+const size_t serviceLatencySamples = 1 << 16;
+
+// Latency percentiles of a HullService's requests, in seconds from
+// submit until the hull was ready.
+struct ServiceLatency {
+	size_t count;
+	double p50;
+	double p99;
+	double max;
+};
+
+// Finds hulls asynchronously on a fixed set of worker threads, for a
+// frontend that takes requests concurrently. Requests wait in a
+// bounded queue: submit blocks while it's full, and trySubmit gives
+// up, so a frontend that outpaces the workers is slowed rather than
+// queueing without limit. A worker that takes a small request takes
+// the small requests queued behind it too, up to a batch's worth, and
+// finds their hulls with one batchHulls call. Where it can, it pins
+// worker i to core i.
+class HullService {
+public:
+	explicit HullService(unsigned threadCount = thread::hardware_concurrency(),
+		size_t queueCapacity = 4096, HullFunction algorithm = quickHull, bool pinThreads = true)
+		: capacity(max(queueCapacity, size_t(1))), algorithm(algorithm), stopping(false),
+		latencies(serviceLatencySamples), latencyCount(0) {
+		const unsigned cores = max(thread::hardware_concurrency(), 1u);
+		for (unsigned i = 0; i < max(threadCount, 1u); ++i) {
+			workers.emplace_back([this] { work(); });
+#ifdef CONVEXHULL_AFFINITY
+			if (pinThreads) {
+				cpu_set_t cpus;
+				CPU_ZERO(&cpus);
+				CPU_SET(i % cores, &cpus);
+				pthread_setaffinity_np(workers.back().native_handle(), sizeof(cpus), &cpus);
+			}
+#else
+			(void)pinThreads;
+			(void)cores;
+#endif
+		}
+	}
+
+	// Finishes the queued requests, then stops the workers.
+	~HullService() {
+		{
+			lock_guard<mutex> lock(queueLock);
+			stopping = true;
+		}
+		notEmpty.notify_all();
+		for (auto& t : workers) {
+			t.join();
+		}
+	}
+
+	HullService(const HullService&) = delete;
+	HullService& operator=(const HullService&) = delete;
+
+	// Queues a request for the hull of v, waiting for room if the
+	// queue is full. The future gets the hull in the order algorithm
+	// gives, or the exception it threw.
+	future<vector<point>> submit(vector<point> v) {
+		unique_lock<mutex> lock(queueLock);
+		notFull.wait(lock, [&] { return queue.size() < capacity; });
+		return push(move(v), lock);
+	}
+
+	// As above, but returns false at once if the queue is full.
+	bool trySubmit(vector<point> v, future<vector<point>>& hull) {
+		unique_lock<mutex> lock(queueLock);
+		if (queue.size() >= capacity) {
+			return false;
+		}
+		hull = push(move(v), lock);
+		return true;
+	}
+
+	// The percentiles over the latest requests.
+	ServiceLatency latency() const {
+		vector<double> sample;
+		ServiceLatency l = { 0, 0, 0, 0 };
+		{
+			lock_guard<mutex> lock(latencyLock);
+			l.count = latencyCount;
+			sample.assign(latencies.begin(), latencies.begin() + min(latencyCount, latencies.size()));
+		}
+		if (sample.empty()) {
+			return l;
+		}
+		auto percentile = [&](double f) {
+			auto it = sample.begin() + min(sample.size() - 1, size_t(f * sample.size()));
+			nth_element(sample.begin(), it, sample.end());
+			return *it;
+		};
+		l.p50 = percentile(0.5);
+		l.p99 = percentile(0.99);
+		l.max = *max_element(sample.begin(), sample.end());
+		return l;
+	}
+
+	size_t threadCount() const {
+		return workers.size();
+	}
+
+private:
+	struct Request {
+		vector<point> points;
+		promise<vector<point>> hull;
+		chrono::steady_clock::time_point submitted;
+	};
+
+	future<vector<point>> push(vector<point> v, unique_lock<mutex>& lock) {
+		Request r;
+		r.points = move(v);
+		r.submitted = chrono::steady_clock::now();
+		future<vector<point>> f = r.hull.get_future();
+		queue.push_back(move(r));
+		lock.unlock();
+		notEmpty.notify_one();
+		return f;
+	}
+
+	// Takes the next request, and the small ones queued behind it if
+	// it's small, until the service stops and the queue is empty.
+	void work() {
+		HullWorkspace ws;
+		vector<Request> batch;
+		vector<point> points;
+		vector<size_t> offsets;
+		vector<point> hulls;
+		vector<size_t> hullOffsets;
+		for (;;) {
+			batch.clear();
+			{
+				unique_lock<mutex> lock(queueLock);
+				notEmpty.wait(lock, [&] { return stopping || !queue.empty(); });
+				if (queue.empty()) {
+					return;
+				}
+				size_t batchPoints = 0;
+				do {
+					batchPoints += queue.front().points.size();
+					batch.push_back(move(queue.front()));
+					queue.pop_front();
+				} while (batch.back().points.size() <= serviceBatchMaxN && !queue.empty() &&
+					queue.front().points.size() <= serviceBatchMaxN &&
+					batchPoints + queue.front().points.size() <= serviceBatchMaxPoints);
+			}
+			notFull.notify_all();
+
+			if (batch.size() == 1) {
+				Request& r = batch[0];
+				const size_t n = r.points.size();
+				try {
+					if (n >= 3) {
+						r.points.resize(algorithm(r.points.data(), n, r.points.data(), ws));
+					}
+				} catch (...) {
+					r.hull.set_exception(current_exception());
+					continue;
+				}
+				finish(r, move(r.points));
+				continue;
+			}
+
+			try {
+				points.clear();
+				offsets.assign(1, 0);
+				for (const Request& r : batch) {
+					points.insert(points.end(), r.points.begin(), r.points.end());
+					offsets.push_back(points.size());
+				}
+				batchHulls(points, offsets, hulls, hullOffsets, algorithm, 1);
+			} catch (...) {
+				for (Request& r : batch) {
+					r.hull.set_exception(current_exception());
+				}
+				continue;
+			}
+			for (size_t i = 0; i < batch.size(); ++i) {
+				finish(batch[i], toPoints(hulls, hullOffsets[i], hullOffsets[i + 1]));
+			}
+		}
+	}
+
+	// Hands r its hull and records how long it took.
+	void finish(Request& r, vector<point> hull) {
+		const double seconds = chrono::duration<double>(chrono::steady_clock::now() - r.submitted).count();
+		r.hull.set_value(move(hull));
+		lock_guard<mutex> lock(latencyLock);
+		latencies[latencyCount++ % latencies.size()] = seconds;
+	}
+
+	const size_t capacity;
+	const HullFunction algorithm;
+	mutex queueLock;
+	condition_variable notEmpty;
+	condition_variable notFull;
+	deque<Request> queue;
+	bool stopping;
+	mutable mutex latencyLock;
+	vector<double> latencies;
+	size_t latencyCount;
+	vector<thread> workers;
+};
+
+// Returns count points from distribution d, the same ones for the same
+// seed.
+vector<point> getPoints(Distribution d, size_t count, unsigned seed) {
+	return generatePoints(d, count, seed);
+}
+
+vector<point> getPoints(size_t count = 100) {
+	return generatePoints(UniformSquare, count, 1);
+}
+
+void print(const vector<point>& v) {
+#ifdef CONVEXHULL_POSIX
+	// Written past cout, straight to stdout, with cout's six digits.
+	cout.flush();
+	HullWriter out(STDOUT_FILENO, 6);
+	out.writeText(v);
+#else
+	for (auto p : v) {
+		cout << p.x << ", " << p.y << '\n';
+	}
+	cout.flush();
+#endif
+}
+
+// Seconds elapsed since start.
+double secondsSince(chrono::steady_clock::time_point start) {
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// Moves a window over n points one point at a time, and times keeping
+// its hull with a DynamicHull against running monotoneChain on each
+// window. The summed hull sizes should match.
+void benchmarkSlidingWindow(size_t n, size_t window) {
+	vector<point> v = getPoints(n);
+	cout << "Sliding window of " << window << " over " << n << " points" << endl;
+
+	auto start = chrono::steady_clock::now();
+	DynamicHull dynamic;
+	size_t total = 0;
+	for (size_t i = 0; i < n; ++i) {
+		dynamic.insert(v[i]);
+		if (i >= window) {
+			dynamic.erase(v[i - window]);
+		}
+		if (i + 1 >= window) {
+			total += dynamic.hull().size();
+		}
+	}
+	cout << "DynamicHull: " << secondsSince(start) << " s, total hull size " << total << endl;
+
+	start = chrono::steady_clock::now();
+	total = 0;
+	for (size_t i = window; i <= n; ++i) {
+		total += monotoneChain(vector<point>(v.begin() + (i - window), v.begin() + i)).size();
+	}
+	cout << "monotoneChain per window: " << secondsSince(start) << " s, total hull size " << total << endl;
+}
+
+#ifdef CONVEXHULL_STATS
+// The bytes allocated so far, on any thread, counted by the operator
+// new below. Only a stats build replaces operator new, so other builds
+// allocate as usual and don't count.
+atomic<size_t> bytesAllocated(0);
+
+void* countedAlloc(size_t size) noexcept {
+	bytesAllocated += size;
+	HULL_COUNT(bytesAllocated, size);
+	return malloc(size ? size : 1);
+}
+
+void* countedAlloc(size_t size, align_val_t alignment) noexcept {
+	bytesAllocated += size;
+	HULL_COUNT(bytesAllocated, size);
+	// aligned_alloc wants a multiple of the alignment.
+	const size_t a = static_cast<size_t>(alignment);
+	return aligned_alloc(a, (size + a - 1) / a * a + (size ? 0 : a));
+}
+
+// Every form of operator new and delete is replaced, so that memory
+// from one is never freed by a library's or sanitizer's other.
+void* operator new(size_t size) {
+	if (void* p = countedAlloc(size)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size) {
+	return ::operator new(size);
+}
+
+void* operator new(size_t size, align_val_t alignment) {
+	if (void* p = countedAlloc(size, alignment)) {
+		return p;
+	}
+	throw bad_alloc();
+}
+
+void* operator new[](size_t size, align_val_t alignment) {
+	return ::operator new(size, alignment);
+}
+
+void* operator new(size_t size, const nothrow_t&) noexcept {
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const nothrow_t&) noexcept {
+	return countedAlloc(size);
+}
+
+void* operator new(size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+	return countedAlloc(size, alignment);
+}
+
+void* operator new[](size_t size, align_val_t alignment, const nothrow_t&) noexcept {
+	return countedAlloc(size, alignment);
+}
+
+// GCC warns about free() on memory from operator new wherever it
+// inlines both into one caller, so the free is kept out of line.
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void countedFree(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p) noexcept {
+	countedFree(p);
+}
+
+void operator delete[](void* p) noexcept {
+	countedFree(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	countedFree(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+	countedFree(p);
+}
+
+void operator delete(void* p, align_val_t) noexcept {
+	countedFree(p);
+}
+
+void operator delete[](void* p, align_val_t) noexcept {
+	countedFree(p);
+}
+
+void operator delete(void* p, size_t, align_val_t) noexcept {
+	countedFree(p);
+}
+
+void operator delete[](void* p, size_t, align_val_t) noexcept {
+	countedFree(p);
+}
+
+void operator delete(void* p, const nothrow_t&) noexcept {
+	countedFree(p);
+}
+
+void operator delete[](void* p, const nothrow_t&) noexcept {
+	countedFree(p);
+}
+
+void operator delete(void* p, align_val_t, const nothrow_t&) noexcept {
+	countedFree(p);
+}
+
+void operator delete[](void* p, align_val_t, const nothrow_t&) noexcept {
+	countedFree(p);
+}
+#endif
+
+// The bytes allocated so far, or 0 in a build that doesn't count them.
+size_t allocatedBytes() {
+#ifdef CONVEXHULL_STATS
+	return bytesAllocated;
+#else
+	return 0;
+#endif
+}
+
+// One benchmark result.
+struct BenchmarkResult {
+	string name;
+	size_t iterations;
+	double seconds;
+	size_t bytes;
+	size_t hullSize;
+};
+
+// The paths through IncrementalHull, DynamicHull, batchHulls,
+// mergeHulls and streamingHull that hullAlgorithms runs, each taking
+// all of v and giving its hull.
+vector<point> incrementalHull(const vector<point>& v) {
+	IncrementalHull h;
+	for (const point& p : v) {
+		h.insert(p);
+	}
+	return h.hull();
+}
+
+// Inserts a point pushed out from each of the first few too, and
+// erases them again, so the hull has to shrink back.
+vector<point> dynamicHull(const vector<point>& v) {
+	DynamicHull h;
+	const size_t extra = min(v.size(), size_t(16));
+	for (size_t i = 0; i < extra; ++i) {
+		h.insert(point(2 * v[i].x + 1, 2 * v[i].y - 1));
+	}
+	for (const point& p : v) {
+		h.insert(p);
+	}
+	for (size_t i = 0; i < extra; ++i) {
+		h.erase(point(2 * v[i].x + 1, 2 * v[i].y - 1));
+	}
+	return h.hull();
+}
+
+// The offsets of sets of setSize points, and a smaller last one, in n
+// points, for batchHulls.
+vector<size_t> setOffsets(size_t n, size_t setSize) {
+	vector<size_t> offsets;
+	for (size_t i = 0; i < n; i += setSize) {
+		offsets.push_back(i);
+	}
+	offsets.push_back(n);
+	return offsets;
+}
+
+// Hulls sets of 1000 points in one batch, then the points of all
+// their hulls.
+vector<point> batchedHull(const vector<point>& v) {
+	const vector<size_t> offsets = setOffsets(v.size(), 1000);
+	vector<point> hulls;
+	vector<size_t> hullOffsets;
+	batchHulls(v, offsets, hulls, hullOffsets);
+	return monotoneChain(hulls);
+}
+
+// Merges the hulls of the two halves of v.
+vector<point> mergedHull(const vector<point>& v) {
+	const vector<point> a(v.begin(), v.begin() + v.size() / 2);
+	const vector<point> b(v.begin() + v.size() / 2, v.end());
+	return mergeHulls(monotoneChain(a), monotoneChain(b));
+}
+
+// Hulls sets of 1000 points in one batch, passes their hulls through
+// serializeHulls and readHulls, and reduces them to one.
+vector<point> reducedHull(const vector<point>& v) {
+	vector<point> hulls;
+	vector<size_t> hullOffsets;
+	batchHulls(v, setOffsets(v.size(), 1000), hulls, hullOffsets);
+	const vector<char> bytes = serializeHulls(hulls, hullOffsets);
+	readHulls(bytes.data(), bytes.size(), hulls, hullOffsets);
+	return reduceHulls(hulls, hullOffsets);
+}
+
+// Several chunks, for all but the smallest inputs.
+vector<point> chunkedStreamingHull(const vector<point>& v) {
+	return streamingHull(v, 4096);
+}
+
+// One of the algorithms the benchmark, the cross-check and the stats
+// report run.
+struct NamedHullAlgorithm {
+	const char* name;
+	vector<point> (*algorithm)(const vector<point>&);
+	bool scalesWithHull;
+
+	// Gift wrapping is O(nh), and h = n on the circle, where pruning
+	// keeps every point. DynamicHull rebuilds chains up to h long on
+	// each insert.
+	bool isSlow(Distribution d, size_t n) const {
+		return scalesWithHull && (n > 100000 || (d == OnCircle && n > 10000));
+	}
+};
+
+const NamedHullAlgorithm hullAlgorithms[] = {
+	{ "giftWrapping", giftWrapping, true },
+	{ "prunedGiftWrapping", prunedGiftWrapping, true },
+	{ "GrahamScan", GrahamScan, false },
+	{ "parallelGrahamScan", [](const vector<point>& v) { return parallelGrahamScan(v); }, false },
+	{ "monotoneChain", monotoneChain, false },
+	{ "parallelMonotoneChain", [](const vector<point>& v) { return parallelMonotoneChain(v); }, false },
+	{ "quickHull", quickHull, false },
+	{ "quickHull(PointSoA)", [](const vector<point>& v) { return quickHull(PointSoA(v)); }, false },
+	{ "parallelQuickHull", [](const vector<point>& v) { return parallelQuickHull(v); }, false },
+	{ "segmentedQuickHull", [](const vector<point>& v) { return segmentedQuickHull(PointSoA(v)); }, false },
+	{ "chanHull", chanHull, false },
+	{ "convexHull", [](const vector<point>& v) { return convexHull(v); }, false },
+	{ "IncrementalHull", incrementalHull, false },
+	{ "DynamicHull", dynamicHull, true },
+	{ "batchHulls", batchedHull, false },
+	{ "mergeHulls", mergedHull, false },
+	{ "reduceHulls", reducedHull, false },
+	{ "streamingHull", chunkedStreamingHull, false },
+};
+
+// Runs hullAlgorithms over every distribution, for n from 100 up to
+// maxN by factors of 10. Each case repeats until it has run for a
+// tenth of a second. Prints the time per call, points per second and,
+// in a CONVEXHULL_STATS build, bytes allocated per call, and writes the results as JSON to
+// jsonPath, if it's given, in the shape Google Benchmark uses.
+void benchmarkAlgorithms(size_t maxN, const string& jsonPath) {
+	vector<BenchmarkResult> results;
+	cout << "algorithm/distribution/n, s per call, points per s, bytes per call, hull size" << endl;
+	for (size_t d = 0; d < distributionCount; ++d) {
+		for (size_t n = 100; n <= maxN; n *= 10) {
+			const vector<point> v = getPoints(Distribution(d), n, 1);
+			for (auto& a : hullAlgorithms) {
+				if (a.isSlow(Distribution(d), n)) {
+					continue;
+				}
+
+				BenchmarkResult r;
+				r.name = string(a.name) + "/" + distributionName(Distribution(d)) + "/" + to_string(n);
+				r.iterations = 0;
+				const size_t bytesBefore = allocatedBytes();
+				auto start = chrono::steady_clock::now();
+				do {
+					r.hullSize = a.algorithm(v).size();
+					++r.iterations;
+				} while (secondsSince(start) < 0.1);
+				r.seconds = secondsSince(start) / r.iterations;
+				r.bytes = (allocatedBytes() - bytesBefore) / r.iterations;
+				results.push_back(r);
+
+				cout << r.name << ", " << r.seconds << ", " << n / r.seconds << ", "
+					<< r.bytes << ", " << r.hullSize << endl;
+			}
+		}
+	}
+
+	if (jsonPath.empty()) {
+		return;
+	}
+	ofstream json(jsonPath);
+	json << "{\n  \"context\": {\n    \"num_cpus\": " << thread::hardware_concurrency()
+		<< "\n  },\n  \"benchmarks\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const BenchmarkResult& r = results[i];
+		const size_t n = stoul(r.name.substr(r.name.rfind('/') + 1));
+		json << "    {\n"
+			<< "      \"name\": \"" << r.name << "\",\n"
+			<< "      \"iterations\": " << r.iterations << ",\n"
+			<< "      \"real_time\": " << r.seconds * 1e9 << ",\n"
+			<< "      \"time_unit\": \"ns\",\n"
+			<< "      \"items_per_second\": " << n / r.seconds << ",\n"
+			<< "      \"bytes_allocated\": " << r.bytes << ",\n"
+			<< "      \"hull_size\": " << r.hullSize << "\n"
+			<< "    }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	json << "  ]\n}\n";
+}
+
+// The vertices of hull, without copies or any exactly collinear with
+// their neighbours, in lexicographic order. Hulls that start at
+// different vertices, run in different directions or keep collinear
+// points or copies compare equal this way.
+vector<point> essentialVertices(vector<point> hull) {
+	for (bool dropped = true; dropped && hull.size() > 2; ) {
+		dropped = false;
+		vector<point> kept;
+		for (size_t i = 0; i < hull.size(); ++i) {
+			const point& before = kept.empty() ? hull.back() : kept.back();
+			if (exactCcw(before, hull[i], hull[(i + 1) % hull.size()]) == 0) {
+				dropped = true;
+			} else {
+				kept.push_back(hull[i]);
+			}
+		}
+		hull.swap(kept);
+	}
+	sort(hull.begin(), hull.end(), isLeftOf);
+	hull.erase(unique(hull.begin(), hull.end(), [](const point& a, const point& b) {
+		return a.x == b.x && a.y == b.y;
+	}), hull.end());
+	return hull;
+}
+
+// The distance from p to the nearest edge of polygon.
+double boundaryDistance(const vector<point>& polygon, const point& p) {
+	double least = numeric_limits<double>::infinity();
+	for (size_t i = 0; i < polygon.size(); ++i) {
+		const point& a = polygon[i];
+		const point& b = polygon[(i + 1) % polygon.size()];
+		const double dx = double(b.x) - a.x;
+		const double dy = double(b.y) - a.y;
+		const double length = dx * dx + dy * dy;
+		double t = length > 0 ? ((p.x - a.x) * dx + (p.y - a.y) * dy) / length : 0;
+		t = min(max(t, 0.0), 1.0);
+		least = min(least, hypot(a.x + t * dx - p.x, a.y + t * dy - p.y));
+	}
+	return least;
+}
+
+// hull without consecutive copies, and, if dropCollinear, without any
+// vertex exactly collinear with its neighbours and between them, in its
+// own order from its leftmost vertex. A vertex where hull doubles back
+// along a line is kept, so a hull out of order still differs this way.
+vector<point> vertexCycle(const vector<point>& hull, bool dropCollinear) {
+	const auto equalPoints = [](const point& p, const point& q) {
+		return p.x == q.x && p.y == q.y;
+	};
+	vector<point> cycle;
+	for (const point& p : hull) {
+		if (cycle.empty() || !equalPoints(cycle.back(), p)) {
+			cycle.push_back(p);
+		}
+	}
+	while (cycle.size() > 1 && equalPoints(cycle.back(), cycle.front())) {
+		cycle.pop_back();
+	}
+	for (bool dropped = dropCollinear; dropped && cycle.size() > 2; ) {
+		dropped = false;
+		vector<point> kept;
+		for (size_t i = 0; i < cycle.size(); ++i) {
+			const point& a = kept.empty() ? cycle.back() : kept.back();
+			const point& b = cycle[i];
+			const point& c = cycle[(i + 1) % cycle.size()];
+			if (exactCcw(a, b, c) == 0 &&
+				(double(b.x) - a.x) * (double(c.x) - b.x) + (double(b.y) - a.y) * (double(c.y) - b.y) > 0) {
+				dropped = true;
+			} else {
+				kept.push_back(b);
+			}
+		}
+		cycle.swap(kept);
+	}
+	rotate(cycle.begin(), min_element(cycle.begin(), cycle.end(), isLeftOf), cycle.end());
+	return cycle;
+}
+
+// Whether cycle, from vertexCycle, goes round cw once like expected: it
+// turns no more than tolerance ccw anywhere, its turns add up to one cw
+// circle, and its signed area is within tolerance of expected's.
+bool goesRoundCwOnce(const vector<point>& cycle, const vector<point>& expected, double tolerance, float scale) {
+	const auto signedArea = [](const vector<point>& polygon) {
+		double sum = 0;
+		for (size_t i = 0; i < polygon.size(); ++i) {
+			const point& a = polygon[i];
+			const point& b = polygon[(i + 1) % polygon.size()];
+			sum += double(a.x) * b.y - double(b.x) * a.y;
+		}
+		return sum / 2;
+	};
+	if (fabs(signedArea(cycle) - signedArea(expected)) > 8 * scale * tolerance) {
+		return false;
+	}
+	if (cycle.size() < 3) {
+		return true;
+	}
+	double turning = 0;
+	for (size_t i = 0; i < cycle.size(); ++i) {
+		const point& a = cycle[(i + cycle.size() - 1) % cycle.size()];
+		const point& b = cycle[i];
+		const point& c = cycle[(i + 1) % cycle.size()];
+		const double turn = exactCcw(a, b, c);
+		if (turn > 4 * scale * tolerance) {
+			return false;
+		}
+		turning += atan2(turn, (double(b.x) - a.x) * (double(c.x) - b.x) + (double(b.y) - a.y) * (double(c.y) - b.y));
+	}
+	return fabs(turning + 2 * acos(-1.0)) < 1;
+}
+
+// Differing vertices past which crossCheckAlgorithms stops looking for
+// rounding as the cause.
+const size_t crossCheckMaxDifferences = 1024;
+
+// How well hull matches the exact hull expected, both cw from their
+// leftmost vertex: "yes" if they have the same vertices in the same
+// order, "collinear" if they do once collinear points are dropped,
+// "rounding" if hull still goes round cw once and the vertices that
+// differ are all within float rounding of the other's boundary, and
+// otherwise "NO".
+const char* compareHulls(const vector<point>& hull, const vector<point>& expected,
+	const vector<point>& expectedVertices, float scale) {
+	const auto equalPoints = [](const point& p, const point& q) {
+		return p.x == q.x && p.y == q.y;
+	};
+	const vector<point> expectedCycle = vertexCycle(expected, false);
+	const vector<point> cycle = vertexCycle(hull, false);
+	if (cycle.size() == expectedCycle.size() &&
+		equal(cycle.begin(), cycle.end(), expectedCycle.begin(), equalPoints)) {
+		return "yes";
+	}
+	const vector<point> essentialCycle = vertexCycle(hull, true);
+	if (essentialCycle.size() == expectedCycle.size() &&
+		equal(essentialCycle.begin(), essentialCycle.end(), expectedCycle.begin(), equalPoints)) {
+		return "collinear";
+	}
+	const double tolerance = 1e-5 * scale;
+	if (!goesRoundCwOnce(cycle, expectedCycle, tolerance, scale)) {
+		return "NO";
+	}
+	const vector<point> vertices = essentialVertices(hull);
+	vector<point> missing, extra;
+	set_difference(expectedVertices.begin(), expectedVertices.end(), vertices.begin(), vertices.end(),
+		back_inserter(missing), isLeftOf);
+	set_difference(vertices.begin(), vertices.end(), expectedVertices.begin(), expectedVertices.end(),
+		back_inserter(extra), isLeftOf);
+	if (missing.size() + extra.size() > crossCheckMaxDifferences) {
+		return "NO";
+	}
+	for (const point& p : missing) {
+		if (boundaryDistance(hull, p) > tolerance) {
+			return "NO";
+		}
+	}
+	for (const point& p : extra) {
+		if (boundaryDistance(expected, p) > tolerance) {
+			return "NO";
+		}
+	}
+	return "rounding";
+}
+
+// Runs hullAlgorithms on each of sets, and checks each hull against the
+// exact one. Prints each algorithm's total time, largest hull and
+// worst agreement under name, and returns the number that didn't agree.
+size_t crossCheckSets(const string& name, const vector<vector<point>>& sets) {
+	const char* const outcomes[] = { "yes", "collinear", "rounding", "NO" };
+	vector<vector<point>> expectedHulls, expectedVertices;
+	vector<float> scales;
+	for (const vector<point>& v : sets) {
+		float scale = 0;
+		for (const point& p : v) {
+			scale = max(scale, max(fabs(p.x), fabs(p.y)));
+		}
+		scales.push_back(scale);
+		expectedHulls.push_back(monotoneChain(v, ExactCcw()));
+		expectedVertices.push_back(essentialVertices(expectedHulls.back()));
+	}
+
+	size_t mismatches = 0;
+	for (auto& a : hullAlgorithms) {
+		auto start = chrono::steady_clock::now();
+		size_t worst = 0;
+		size_t hullSize = 0;
+		for (size_t i = 0; i < sets.size(); ++i) {
+			const vector<point> hull = a.algorithm(sets[i]);
+			const char* agrees = compareHulls(hull, expectedHulls[i], expectedVertices[i], scales[i]);
+			worst = max(worst, size_t(find_if(begin(outcomes), end(outcomes), [&](const char* o) {
+				return strcmp(o, agrees) == 0;
+			}) - begin(outcomes)));
+			hullSize = max(hullSize, hull.size());
+		}
+		const double seconds = secondsSince(start);
+		mismatches += worst == 3;
+		cout << a.name << "/" << name << ", " << seconds << ", " << hullSize << ", " << outcomes[worst] << endl;
+	}
+	return mismatches;
+}
+
+// The measures measureHull finds, from every pair of vertices of the
+// convex polygon h and a rectangle along every edge, in O(h^2) and in
+// double. Only the lengths and areas are filled in.
+HullMeasures bruteForceMeasures(const vector<point>& h) {
+	double diameter = 0;
+	double width = numeric_limits<double>::infinity();
+	double area = numeric_limits<double>::infinity();
+	double perimeter = numeric_limits<double>::infinity();
+	for (size_t i = 0; i < h.size(); ++i) {
+		for (size_t j = i + 1; j < h.size(); ++j) {
+			diameter = max(diameter, hypot(double(h[j].x) - h[i].x, double(h[j].y) - h[i].y));
+		}
+
+		const point& a = h[i];
+		const point& b = h[(i + 1) % h.size()];
+		const double length = hypot(double(b.x) - a.x, double(b.y) - a.y);
+		if (length == 0) {
+			continue;
+		}
+		const double ux = (double(b.x) - a.x) / length;
+		const double uy = (double(b.y) - a.y) / length;
+		double alongMin = 0, alongMax = 0, acrossMin = 0, acrossMax = 0;
+		for (const point& p : h) {
+			const double along = (p.x - a.x) * ux + (p.y - a.y) * uy;
+			const double across = (p.y - a.y) * ux - (p.x - a.x) * uy;
+			alongMin = min(alongMin, along);
+			alongMax = max(alongMax, along);
+			acrossMin = min(acrossMin, across);
+			acrossMax = max(acrossMax, across);
+		}
+		width = min(width, acrossMax - acrossMin);
+		area = min(area, (alongMax - alongMin) * (acrossMax - acrossMin));
+		perimeter = min(perimeter, 2 * (alongMax - alongMin + acrossMax - acrossMin));
+	}
+
+	HullMeasures m = HullMeasures();
+	m.diameter = float(diameter);
+	m.width = float(width);
+	m.minAreaRectangle.area = float(area);
+	m.minPerimeterRectangle.perimeter = float(perimeter);
+	return m;
+}
+
+// Measures the hulls of many sets of 1000 points from every
+// distribution with measureHulls, and checks them against
+// bruteForceMeasures. Then does the same for parallelograms, regular
+// polygons with an even number of sides and centrally symmetric
+// octagons, whose parallel edges the random hulls almost never have.
+// Prints the time measureHulls took and whether they agreed to within
+// rounding, and returns the number that didn't.
+size_t crossCheckMeasures(uint64_t seed) {
+	const size_t sets = 64;
+	const size_t setSize = 1000;
+	size_t mismatches = 0;
+
+	auto check = [&](const string& name, const vector<point>& hulls, const vector<size_t>& hullOffsets) {
+		float scale = 0;
+		for (const point& p : hulls) {
+			scale = max(scale, max(fabs(p.x), fabs(p.y)));
+		}
+
+		auto start = chrono::steady_clock::now();
+		vector<HullMeasures> measures;
+		measureHulls(hulls, hullOffsets, measures);
+		const double seconds = secondsSince(start);
+
+		auto near = [](double found, double expected, double tolerance) {
+			return fabs(found - expected) <= 1e-4 * fabs(expected) + tolerance;
+		};
+		bool agrees = true;
+		for (size_t i = 0; i + 1 < hullOffsets.size(); ++i) {
+			const vector<point> h = toPoints(hulls, hullOffsets[i], hullOffsets[i + 1]);
+			if (h.size() < 3) {
+				continue;
+			}
+			const HullMeasures& m = measures[i];
+			const HullMeasures expected = bruteForceMeasures(h);
+			const double tolerance = 1e-5 * scale;
+			agrees = agrees && near(m.diameter, expected.diameter, tolerance) &&
+				near(m.width, expected.width, tolerance) &&
+				near(m.minAreaRectangle.area, expected.minAreaRectangle.area, tolerance * scale) &&
+				near(m.minPerimeterRectangle.perimeter, expected.minPerimeterRectangle.perimeter, tolerance);
+		}
+		mismatches += !agrees;
+		cout << "measureHulls/" << name << ", " << seconds << ", " << hulls.size() << ", "
+			<< (agrees ? "yes" : "NO") << endl;
+	};
+
+	for (size_t d = 0; d < distributionCount; ++d) {
+		const vector<point> v = generatePoints(Distribution(d), sets * setSize, seed);
+		vector<point> hulls;
+		vector<size_t> hullOffsets;
+		batchHulls(v, setOffsets(v.size(), setSize), hulls, hullOffsets);
+		check(string(distributionName(Distribution(d))) + "/" + to_string(sets) + "x" + to_string(setSize),
+			hulls, hullOffsets);
+	}
+
+	// Random whole numbers in [-100, 100], so that edges meant to be
+	// parallel are exactly parallel.
+	const vector<point> r = generatePoints(UniformSquare, 8 * sets, seed);
+	auto whole = [&](size_t i) {
+		return point(round(r[i].x), round(r[i].y));
+	};
+	// Appends the hull of corners to hulls, cw or ccw and starting
+	// at any vertex.
+	auto add = [&](const vector<point>& corners, size_t i, vector<point>& hulls, vector<size_t>& hullOffsets) {
+		vector<point> h = monotoneChain(corners, ExactCcw());
+		if (i % 2) {
+			reverse(h.begin(), h.end());
+		}
+		rotate(h.begin(), h.begin() + i % max(h.size(), size_t(1)), h.end());
+		hulls.insert(hulls.end(), h.begin(), h.end());
+		hullOffsets.push_back(hulls.size());
+	};
+
+	vector<point> hulls;
+	vector<size_t> hullOffsets(1, 0);
+	for (size_t i = 0; i < sets; ++i) {
+		const point c = whole(2 * i);
+		const point u = whole(2 * i + 1);
+		const point w = whole(2 * i + 2);
+		add({ point(c.x + u.x + w.x, c.y + u.y + w.y), point(c.x - u.x + w.x, c.y - u.y + w.y),
+			point(c.x - u.x - w.x, c.y - u.y - w.y), point(c.x + u.x - w.x, c.y + u.y - w.y) },
+			i, hulls, hullOffsets);
+	}
+	check("parallelograms/" + to_string(sets), hulls, hullOffsets);
+
+	hulls.clear();
+	hullOffsets.assign(1, 0);
+	for (size_t i = 0; i < sets; ++i) {
+		const size_t sides = 4 + 2 * (i % 15);
+		const double turn = r[i].x / 100;
+		const double radius = 50 + fabs(r[i].y) / 2;
+		vector<point> corners;
+		for (size_t k = 0; k < sides; ++k) {
+			const double a = turn + 2 * acos(-1.0) * k / sides;
+			corners.push_back(point(float(radius * cos(a)), float(radius * sin(a))));
+		}
+		add(corners, i, hulls, hullOffsets);
+	}
+	check("even-polygons/" + to_string(sets), hulls, hullOffsets);
+
+	hulls.clear();
+	hullOffsets.assign(1, 0);
+	for (size_t i = 0; i < sets; ++i) {
+		const point c = whole(8 * i % r.size());
+		vector<point> corners;
+		for (size_t k = 1; k <= 4; ++k) {
+			const point p = whole((8 * i + k) % r.size());
+			corners.push_back(point(c.x + p.x, c.y + p.y));
+			corners.push_back(point(c.x - p.x, c.y - p.y));
+		}
+		add(corners, i, hulls, hullOffsets);
+	}
+	check("symmetric-octagons/" + to_string(sets), hulls, hullOffsets);
+
+	return mismatches;
+}
+
+// Checks that n points from every distribution come out the same
+// generated on one thread, on all of them into a PointSoA, in uneven
+// pieces, and as a shorter set. Prints the time generatePointSoA took
+// and whether they agreed, and returns the number that didn't.
+size_t crossCheckGenerators(size_t n, uint64_t seed) {
+	size_t mismatches = 0;
+	for (size_t d = 0; d < distributionCount; ++d) {
+		const Distribution dist = Distribution(d);
+		const vector<point> expected = generatePoints(dist, n, seed, 1);
+
+		auto start = chrono::steady_clock::now();
+		const PointSoA soa = generatePointSoA(dist, n, seed);
+		const double seconds = secondsSince(start);
+
+		vector<point> pieces(n);
+		for (size_t first = 0, count = 1; first < n; first += count, count = count * 3 + 1) {
+			count = min(count, n - first);
+			generatePoints(dist, seed, first, count, pieces.data() + first, 3);
+		}
+		const vector<point> prefix = generatePoints(dist, n / 3, seed);
+
+		bool agrees = soa.size() == n;
+		for (size_t i = 0; agrees && i < n; ++i) {
+			const point& p = expected[i];
+			agrees = soa.x[i] == p.x && soa.y[i] == p.y && pieces[i].x == p.x && pieces[i].y == p.y &&
+				(i >= prefix.size() || (prefix[i].x == p.x && prefix[i].y == p.y));
+		}
+		mismatches += !agrees;
+		cout << "generatePointSoA/" << distributionName(dist) << "/" << n << ", " << seconds << ", "
+			<< n << ", " << (agrees ? "yes" : "NO") << endl;
+	}
+	return mismatches;
+}
+
+// Checks HullIndex's queries on the exact hull of n points from every
+// distribution against the same queries answered by testing every
+// vertex or edge, for random points, directions, lines and segments
+// around the hull. Queries whose answer is within rounding of changing
+// are skipped. Prints the time the indexed queries took and whether
+// they agreed, and returns the number that didn't.
+size_t crossCheckHullIndex(size_t n, uint64_t seed) {
+	const size_t queries = 2000;
+	size_t mismatches = 0;
+	for (size_t d = 0; d < distributionCount; ++d) {
+		// The exact hull has no collinear points, and the index turns it
+		// ccw.
+		const HullIndex index(monotoneChain(generatePoints(Distribution(d), n, seed), ExactCcw()));
+		const vector<point>& h = index.vertices();
+		if (h.size() < 3) {
+			continue;
+		}
+		float minX = h[0].x, maxX = h[0].x, minY = h[0].y, maxY = h[0].y;
+		for (const point& p : h) {
+			minX = min(minX, p.x);
+			maxX = max(maxX, p.x);
+			minY = min(minY, p.y);
+			maxY = max(maxY, p.y);
+		}
+		const float scale = max(max(fabs(minX), fabs(maxX)), max(fabs(minY), fabs(maxY)));
+		const double tolerance = 1e-5 * scale * scale;
+
+		// Points in the hull's bounding box, grown by half on each side,
+		// from uniform ones in [-100, 100].
+		vector<point> q = generatePoints(UniformSquare, 2 * queries, seed + d + 1);
+		for (point& p : q) {
+			p = point((minX + maxX) / 2 + (maxX - minX) * p.x / 100,
+				(minY + maxY) / 2 + (maxY - minY) * p.y / 100);
+		}
+
+		// How far p is inside edge i's line, or outside if negative.
+		auto inside = [&](size_t i, const point& p) {
+			return exactCcw(h[i], h[(i + 1) % h.size()], p);
+		};
+		// How far inside every edge p is, negative if it's outside one.
+		auto depth = [&](const point& p) {
+			double least = numeric_limits<double>::infinity();
+			for (size_t i = 0; i < h.size(); ++i) {
+				least = min(least, inside(i, p));
+			}
+			return least;
+		};
+		// How far the line through a and b misses the hull, negative if
+		// it hits it.
+		auto lineMiss = [&](const point& a, const point& b) {
+			double leftMost = numeric_limits<double>::infinity();
+			double rightMost = numeric_limits<double>::infinity();
+			for (const point& p : h) {
+				leftMost = min(leftMost, exactCcw(a, b, p));
+				rightMost = min(rightMost, -exactCcw(a, b, p));
+			}
+			return max(leftMost, rightMost);
+		};
+
+		auto start = chrono::steady_clock::now();
+		vector<uint8_t> contains(queries), hasTangents(queries), hitsLine(queries), hitsSegment(queries);
+		vector<size_t> lefts(queries), rights(queries), extremes(queries);
+		for (size_t i = 0; i < queries; ++i) {
+			const point& p = q[2 * i];
+			const point& r = q[2 * i + 1];
+			contains[i] = index.contains(p);
+			hasTangents[i] = index.tangents(p, lefts[i], rights[i]);
+			hitsLine[i] = index.hitsLine(p, r);
+			hitsSegment[i] = index.hitsSegment(p, r);
+			extremes[i] = index.extreme(point(r.x - p.x, r.y - p.y));
+		}
+		const double seconds = secondsSince(start);
+
+		bool agrees = true;
+		for (size_t i = 0; agrees && i < queries; ++i) {
+			const point& p = q[2 * i];
+			const point& r = q[2 * i + 1];
+
+			const double pDepth = depth(p);
+			if (fabs(pDepth) > tolerance) {
+				agrees = agrees && bool(contains[i]) == (pDepth > 0) && bool(hasTangents[i]) == (pDepth < 0);
+				if (agrees && pDepth < 0) {
+					for (const point& v : h) {
+						agrees = agrees && exactCcw(p, h[lefts[i]], v) <= tolerance &&
+							exactCcw(p, h[rights[i]], v) >= -tolerance;
+					}
+				}
+			}
+
+			const double line = lineMiss(p, r);
+			if (fabs(line) > tolerance) {
+				agrees = agrees && bool(hitsLine[i]) == (line < 0);
+			}
+
+			// Two convex shapes miss each other exactly when a line
+			// through an edge of one separates them.
+			double segment = line;
+			for (size_t e = 0; e < h.size(); ++e) {
+				segment = max(segment, min(-inside(e, p), -inside(e, r)));
+			}
+			if (fabs(segment) > tolerance) {
+				agrees = agrees && bool(hitsSegment[i]) == (segment < 0);
+			}
+
+			const point dir(r.x - p.x, r.y - p.y);
+			double farthest = -numeric_limits<double>::infinity();
+			for (const point& v : h) {
+				farthest = max(farthest, double(dir.x) * v.x + double(dir.y) * v.y);
+			}
+			const point& e = h[extremes[i]];
+			agrees = agrees && double(dir.x) * e.x + double(dir.y) * e.y >=
+				farthest - 1e-5 * scale * (fabs(dir.x) + fabs(dir.y));
+		}
+		mismatches += !agrees;
+		cout << "HullIndex/" << distributionName(Distribution(d)) << "/" << n << ", " << seconds << ", "
+			<< h.size() << ", " << (agrees ? "yes" : "NO") << endl;
+	}
+	return mismatches;
+}
+
+// Runs hullAlgorithms on every distribution, for n from 100 up to
+// maxN by factors of 10, on points generated for seed, and checks each
+// hull against the exact one, from monotoneChain with ExactCcw. Prints
+// the time each took and how well it agreed, and returns the number
+// that didn't. Then does the same for zero, one and two points, for
+// many small sets of duplicates, and for points at -0 and 0, and
+// checks measureHulls, HullIndex and the generators.
+size_t crossCheckAlgorithms(size_t maxN, uint64_t seed) {
+	size_t mismatches = 0;
+	cout << "algorithm/distribution/n, s, hull size, agrees" << endl;
+	for (size_t d = 0; d < distributionCount; ++d) {
+		for (size_t n = 100; n <= maxN; n *= 10) {
+			const vector<point> v = generatePoints(Distribution(d), n, seed);
+			float scale = 0;
+			for (const point& p : v) {
+				scale = max(scale, max(fabs(p.x), fabs(p.y)));
+			}
+			const vector<point> expected = monotoneChain(v, ExactCcw());
+			const vector<point> expectedVertices = essentialVertices(expected);
+
+			for (auto& a : hullAlgorithms) {
+				if (a.isSlow(Distribution(d), n)) {
+					continue;
+				}
+
+				auto start = chrono::steady_clock::now();
+				const vector<point> hull = a.algorithm(v);
+				const double seconds = secondsSince(start);
+				const char* agrees = compareHulls(hull, expected, expectedVertices, scale);
+				mismatches += strcmp(agrees, "NO") == 0;
+				cout << a.name << "/" << distributionName(Distribution(d)) << "/" << n << ", "
+					<< seconds << ", " << hull.size() << ", " << agrees << endl;
+			}
+		}
+	}
+
+	// No points, one or two, or one repeated, are their own hull, and
+	// every path has to return them without tripping over them.
+	const point p(3, -2);
+	const point q(-1, 5);
+	mismatches += crossCheckSets("small/0", { vector<point>() });
+	mismatches += crossCheckSets("small/1", { vector<point>(1, p) });
+	mismatches += crossCheckSets("small/2", { { p, q }, { q, p }, { p, p } });
+	mismatches += crossCheckSets("small/1x100", { vector<point>(100, p) });
+	mismatches += crossCheckSets("small/2x100", { vector<point>(100, p), vector<point>(100, q) });
+
+	// Sets of a few distinct points each repeated many times find
+	// algorithms that trip over a copy of a point already on the hull,
+	// but any one set only does so by chance, so many small ones are
+	// checked.
+	const size_t duplicateSets = 64;
+	const size_t duplicateN = 100;
+	vector<vector<point>> sets;
+	for (size_t i = 0; i < duplicateSets; ++i) {
+		sets.push_back(generatePoints(Duplicates, duplicateN, seed * duplicateSets + i));
+	}
+	mismatches += crossCheckSets(string(distributionName(Duplicates)) + "/" + to_string(duplicateSets) +
+		"x" + to_string(duplicateN), sets);
+
+	// -0 and 0 compare equal, so the sorts have to order them as equal
+	// too, on the small and the radix sort paths.
+	vector<point> signedZeros = { point(-0.0f, 10), point(0, 3), point(0, -4), point(5, 0),
+		point(0, -10), point(-0.0f, -0.0f) };
+	vector<point> signedZeroColumns;
+	for (size_t i = 0; i < 8192; ++i) {
+		const float y = float(i % 201) - 100;
+		signedZeroColumns.push_back(point(i % 4 == 0 ? 1.0f : i % 2 ? 0.0f : -0.0f, i % 3 ? y : -0.0f));
+	}
+	mismatches += crossCheckSets("signed-zeros", { signedZeros, signedZeroColumns });
+
+	mismatches += crossCheckMeasures(seed);
+	mismatches += crossCheckHullIndex(min(maxN, size_t(10000)), seed);
+	mismatches += crossCheckGenerators(maxN, seed);
+
+	cout << mismatches << " mismatches" << endl;
+	return mismatches;
+}
+
+// Submits requests requests for the hulls of n points each to a
+// HullService from four client threads, and prints the throughput and
+// latency percentiles.
+void benchmarkService(size_t requests, size_t n) {
+	const vector<point> v = getPoints(UniformSquare, n, 1);
+	const size_t clients = 4;
+	auto start = chrono::steady_clock::now();
+	size_t total = 0;
+	{
+		HullService service;
+		vector<thread> threads;
+		vector<size_t> hullSizes(clients);
+		for (size_t c = 0; c < clients; ++c) {
+			threads.emplace_back([&, c] {
+				// Keep a few requests in flight, as a frontend would.
+				deque<future<vector<point>>> pending;
+				for (size_t i = c; i < requests; i += clients) {
+					pending.push_back(service.submit(v));
+					if (pending.size() > 16) {
+						hullSizes[c] += pending.front().get().size();
+						pending.pop_front();
+					}
+				}
+				for (auto& f : pending) {
+					hullSizes[c] += f.get().size();
+				}
+			});
+		}
+		for (auto& t : threads) {
+			t.join();
+		}
+		for (size_t h : hullSizes) {
+			total += h;
+		}
+
+		const double seconds = secondsSince(start);
+		const ServiceLatency l = service.latency();
+		cout << "HullService, " << service.threadCount() << " workers, " << requests
+			<< " requests of " << n << " points: " << requests / seconds << " requests per s, p50 "
+			<< l.p50 << " s, p99 " << l.p99 << " s, max " << l.max << " s, total hull size " << total << endl;
+	}
+}
+
+#if defined(CONVEXHULL_STATS) || defined(CONVEXHULL_TRACE) || defined(CONVEXHULL_TRACY)
+// Runs each of hullAlgorithms once on n uniform points and prints its
+// hullStats(). With CONVEXHULL_TRACE, writes the trace to tracePath
+// too, if it's given.
+void reportHullStats(size_t n, const string& tracePath) {
+	const vector<point> v = getPoints(UniformSquare, n, 1);
+	cout << "algorithm, hull size, ccw, partition discards, pops, max depth, bytes, "
+		"sort s, scan s, merge s" << endl;
+	for (auto& a : hullAlgorithms) {
+		resetHullStats();
+		const size_t hullSize = a.algorithm(v).size();
+		const HullStats& s = hullStats();
+		cout << a.name << ", " << hullSize << ", " << s.ccwCount << ", " << s.partitionDiscards
+			<< ", " << s.pops << ", " << s.maxDepth << ", " << s.bytesAllocated << ", "
+			<< s.sortSeconds << ", " << s.scanSeconds << ", " << s.mergeSeconds << endl;
+	}
+
+#ifdef CONVEXHULL_TRACE
+	if (!tracePath.empty()) {
+		writeTrace(tracePath);
+	}
+#else
+	(void)tracePath;
+#endif
+}
+#endif
+
+int main(int argc, char* argv[]) {
+	if (argc > 1 && string(argv[1]) == "--bench") {
+		size_t maxN = argc > 2 ? stoul(argv[2]) : 1000000;
+		benchmarkAlgorithms(maxN, argc > 3 ? argv[3] : "");
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]) == "--bench-window") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 20000;
+		size_t window = argc > 3 ? stoul(argv[3]) : 1000;
+		// Windows of fewer than two points have no hull worth timing.
+		window = max(window, size_t(2));
+		benchmarkSlidingWindow(max(n, window), window);
+		return 0;
+	}
+
+	if (argc > 1 && string(argv[1]) == "--check") {
+		size_t maxN = argc > 2 ? stoul(argv[2]) : 1000000;
+		uint64_t seed = argc > 3 ? stoull(argv[3]) : 1;
+		return crossCheckAlgorithms(maxN, seed) == 0 ? 0 : 1;
+	}
+
+	if (argc > 1 && string(argv[1]) == "--serve") {
+		size_t requests = argc > 2 ? stoul(argv[2]) : 100000;
+		size_t n = argc > 3 ? stoul(argv[3]) : 100;
+		benchmarkService(requests, n);
+		return 0;
+	}
+
+#if defined(CONVEXHULL_STATS) || defined(CONVEXHULL_TRACE) || defined(CONVEXHULL_TRACY)
+	if (argc > 1 && string(argv[1]) == "--stats") {
+		size_t n = argc > 2 ? stoul(argv[2]) : 100000;
+		reportHullStats(n, argc > 3 ? argv[3] : "");
+		return 0;
+	}
+#endif
+
+#ifdef CONVEXHULL_POSIX
+	if (argc > 4 && string(argv[1]) == "--generate") {
+		size_t d = 0;
+		while (d < distributionCount && argv[2] != string(distributionName(Distribution(d)))) {
+			++d;
+		}
+		if (d == distributionCount) {
+			cerr << "unknown distribution " << argv[2] << endl;
+			return 1;
+		}
+		uint64_t seed = argc > 5 ? stoull(argv[5]) : 1;
+		generatePointFile(argv[4], Distribution(d), stoull(argv[3]), seed);
+		return 0;
+	}
+
+	if (argc > 2 && string(argv[1]) == "--hull-file") {
+		size_t chunkSize = argc > 3 ? stoul(argv[3]) : streamChunkSize;
+		vector<point> h = streamingHull(string(argv[2]), chunkSize);
+		cout << "streamingHull point count: " << h.size() << endl;
+		print(h);
+		return 0;
+	}
+#endif
+
+	vector<point> v = getPoints();
+	
+	vector<point> h = quickHull(v);
+	cout << "quickHull point count: " << h.size() << endl;
+	print(h);
+
+ 	h = giftWrapping(v);
+	cout << endl << "giftWrapping point count: " << h.size() << endl;
+	print(h);
+
+	h = monotoneChain(v);
+	cout << endl << "monotoneChain point count: " << h.size() << endl;
+	print(h);
+
+	h = monotoneChain(v, ExactCcw());
+	cout << endl << "monotoneChain with exactCcw point count: " << h.size() << endl;
+	print(h);
+
+	h = parallelMonotoneChain(v);
+	cout << endl << "parallelMonotoneChain point count: " << h.size() << endl;
+	print(h);
+
+	h = parallelQuickHull(v);
+	cout << endl << "parallelQuickHull point count: " << h.size() << endl;
+	print(h);
+	
+	IncrementalHull incremental;
+	for (auto p : v) {
+		incremental.insert(p);
+	}
+	h = incremental.hull();
+	cout << endl << "IncrementalHull point count: " << h.size() << endl;
+	print(h);
+	
+	h = GrahamScan(v);
+	cout << endl << "GrahamScan point count: " << h.size() << endl;
+	print(h);
+
+	h = parallelGrahamScan(v);
+	cout << endl << "parallelGrahamScan point count: " << h.size() << endl;
+	print(h);
+
+	h = chanHull(v);
+	cout << endl << "chanHull point count: " << h.size() << endl;
+	print(h);
+
+	h = convexHull(v);
+	cout << endl << "convexHull point count: " << h.size() << endl;
+	print(h);
+
+	const vector<point> firstHalf(v.begin(), v.begin() + v.size() / 2);
+	const vector<point> secondHalf(v.begin() + v.size() / 2, v.end());
+	h = mergeHulls(quickHull(firstHalf), quickHull(secondHalf));
+	cout << endl << "mergeHulls point count: " << h.size() << endl;
+	print(h);
+
+	HullIndex index(h);
+	PointSoA soa(v);
+	vector<uint8_t> inside(v.size());
+	index.contains(soa, inside.data());
+	cout << endl << "HullIndex contains " << count(inside.begin(), inside.end(), 1)
+		<< " of " << v.size() << " points" << endl;
+
+	// Jitter the points a little, as from one frame to the next.
+	CoherentHull coherent;
+	coherent.update(v);
+	vector<point> moved(v);
+	for (size_t i = 0; i < moved.size(); ++i) {
+		moved[i].x += 0.01f * ((i % 3) - 1.0f);
+		moved[i].y += 0.01f * ((i % 5) - 2.0f);
+	}
+	cout << "CoherentHull point count after a frame: " << coherent.update(moved).size()
+		<< ", reprocessing " << coherent.changedPoints() << " points" << endl;
+
+	const HullMeasures measures = measureHull(h);
+	cout << "measureHull diameter " << measures.diameter << ", width " << measures.width
+		<< ", least rectangle area " << measures.minAreaRectangle.area
+		<< ", least rectangle perimeter " << measures.minPerimeterRectangle.perimeter << endl;
+
+	h = quantizedHull(v, Quantizer<int16_t>(-100, -100, 100, 100));
+	cout << endl << "quantizedHull on an int16 grid point count: " << h.size() << endl;
+	print(h);
+
+	h = approximateHull(v, 16);
+	cout << endl << "approximateHull with 16 strips point count: " << h.size() << endl;
+	print(h);
+
+	size_t culled;
+	h = quickHull(aklToussaint(v, &culled));
+	cout << endl << "aklToussaint culled " << culled << " of " << v.size() << " points" << endl;
+	cout << "quickHull point count: " << h.size() << endl;
+	print(h);
+
+	h = prunedGiftWrapping(v);
+	cout << endl << "prunedGiftWrapping point count: " << h.size() << endl;
 	print(h);
 
 	return 0;